@@ -0,0 +1,45 @@
+project "Benchmarks"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	exceptionhandling "Off"
+	rtti "Off"
+    debugdir "../"
+	-- Builds just the parts of the engine being measured rather than linking it, so this runs headless and on Linux
+	files 
+    {
+        "Source/**.cpp",
+        "Source/**.h",
+        "../Engine/Source/Core/Arena.cpp",
+        "../Engine/Source/Core/ErrorHandling.cpp",
+        "../Engine/Source/Core/FileStream.cpp",
+        "../Engine/Source/Core/Json*.cpp",
+        "../Engine/Source/Core/Log.cpp",
+        "../Engine/Source/Core/MappedFile_*.cpp",
+        "../Engine/Source/Core/NumberFormatting.cpp",
+        "../Engine/Source/Core/NumberParsing.cpp",
+        "../Engine/Source/Core/Parallel.cpp",
+        "../Engine/Source/Core/Path.cpp",
+        "../Engine/Source/Core/Scanning.cpp",
+        "../Engine/Source/Core/Vsnprintf.cpp"
+    }
+	includedirs
+	{
+		"../Engine/Source",
+		"../Engine/Lib/SDL2-2.0.8/include",
+		"../Engine/Source/ThirdParty/EABase/include/Common",
+		"../Engine/Source/ThirdParty/EASTL/include",
+        "Source/"
+	}
+    links 
+	{ 
+		"SDL2",
+		"SDL2main",
+		"EASTL"
+	}
+    filter "platforms:x86_64"
+        libdirs { "../Engine/Lib/SDL2-2.0.8/lib/x64" }
+    filter "platforms:x86"
+        libdirs { "../Engine/Lib/SDL2-2.0.8/lib/x86" }
+	filter "system:linux"
+		links { "dl", "pthread" }
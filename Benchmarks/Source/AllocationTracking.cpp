@@ -0,0 +1,109 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "AllocationTracking.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+namespace
+{
+	// Each allocation is preceded by a header with its size and the start of the block it was carved from,
+	// so every form of delete can find both regardless of which new made the allocation
+	struct Header
+	{
+		void* m_pBlock;
+		size_t m_size;
+	};
+	static constexpr size_t HeaderSize = 16;
+	static_assert(sizeof(Header) <= HeaderSize, "Allocation header doesn't fit");
+
+	std::atomic<uint64_t> allocationCount{ 0 };
+	std::atomic<size_t> liveBytes{ 0 };
+	std::atomic<size_t> peakBytes{ 0 };
+	size_t baselineBytes{ 0 };
+
+	// ***********************************************************************
+
+	void* TrackedAllocate(size_t size, size_t alignment = HeaderSize)
+	{
+		if (alignment < HeaderSize)
+			alignment = HeaderSize;
+
+		char* pBlock = (char*)malloc(size + alignment + HeaderSize);
+		if (pBlock == nullptr)
+			return nullptr;
+
+		char* pResult = (char*)(((uintptr_t)pBlock + HeaderSize + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		Header* pHeader = (Header*)(pResult - HeaderSize);
+		pHeader->m_pBlock = pBlock;
+		pHeader->m_size = size;
+
+		allocationCount++;
+		size_t live = liveBytes += size;
+		size_t peak = peakBytes.load();
+		while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+		return pResult;
+	}
+
+	// ***********************************************************************
+
+	void TrackedFree(void* pMemory)
+	{
+		if (pMemory == nullptr)
+			return;
+
+		Header* pHeader = (Header*)((char*)pMemory - HeaderSize);
+		liveBytes -= pHeader->m_size;
+		free(pHeader->m_pBlock);
+	}
+}
+
+// ***********************************************************************
+
+void An::ResetAllocationStats()
+{
+	allocationCount = 0;
+	baselineBytes = liveBytes;
+	peakBytes = baselineBytes;
+}
+
+// ***********************************************************************
+
+An::AllocationStats An::GetAllocationStats()
+{
+	AllocationStats stats;
+	stats.m_count = allocationCount;
+	stats.m_peakBytes = peakBytes - baselineBytes;
+	return stats;
+}
+
+// Replacements for the global allocation functions
+///////////////////////////
+
+void* operator new(size_t size) { return TrackedAllocate(size); }
+void* operator new[](size_t size) { return TrackedAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return TrackedAllocate(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return TrackedAllocate(size, (size_t)alignment); }
+
+void operator delete(void* pMemory) noexcept { TrackedFree(pMemory); }
+void operator delete[](void* pMemory) noexcept { TrackedFree(pMemory); }
+void operator delete(void* pMemory, size_t) noexcept { TrackedFree(pMemory); }
+void operator delete[](void* pMemory, size_t) noexcept { TrackedFree(pMemory); }
+void operator delete(void* pMemory, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete[](void* pMemory, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete(void* pMemory, size_t, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete[](void* pMemory, size_t, std::align_val_t) noexcept { TrackedFree(pMemory); }
+
+// EASTL expects us to define these, see allocator.h line 194. The engine defines them in Engine.cpp, which isn't part of this build
+void* operator new[](size_t size, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+	return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+	return TrackedAllocate(size, alignment);
+}
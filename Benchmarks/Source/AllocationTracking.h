@@ -0,0 +1,21 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace An
+{
+    // The benchmarks replace operator new and delete, and the allocation functions EASTL needs, with versions that count
+    // every heap allocation made through them. Arenas take their blocks straight from malloc so aren't included.
+    struct AllocationStats
+    {
+        uint64_t m_count{ 0 }; // Allocations made since the last reset
+        size_t m_peakBytes{ 0 }; // The most memory in use at once since the last reset, above what was in use at the reset
+    };
+
+    void ResetAllocationStats();
+
+    AllocationStats GetAllocationStats();
+}
@@ -0,0 +1,145 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "Benchmarks.h"
+
+#include "Core/NumberParsing.h"
+
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <SDL.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace An
+{
+	// ***********************************************************************
+
+	double SecondsSince(uint64_t startTime)
+	{
+		return double(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+	}
+
+	// ***********************************************************************
+
+	// The number parsing json used before ParseNumber, lex the number, copy it out and hand it to strtod
+	const char* ParseNumberStrtod(const char* cursor, const char* end, ParsedNumber& outNumber)
+	{
+		const char* start = cursor;
+		while (cursor < end)
+		{
+			char c = *cursor;
+			if (!((c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.' || c == 'E' || c == 'e'))
+				break;
+			cursor++;
+		}
+
+		char lexeme[64];
+		size_t length = eastl::min(size_t(cursor - start), sizeof(lexeme) - 1);
+		memcpy(lexeme, start, length);
+		lexeme[length] = '\0';
+
+		double number = strtod(lexeme, nullptr);
+		double intPart;
+		outNumber.m_isInteger = modf(number, &intPart) == 0.0;
+		outNumber.m_integer = (int64_t)intPart;
+		outNumber.m_floating = number;
+		return cursor;
+	}
+
+	// ***********************************************************************
+
+	eastl::string MakeNumberCorpus(int count)
+	{
+		eastl::string corpus;
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		auto Random = [&state]() { state ^= state << 13; state ^= state >> 7; state ^= state << 17; return state; };
+
+		for (int i = 0; i < count; i++)
+		{
+			double value = (double)(int64_t)(Random() >> 11) / (double)(1ull << 53) * 2000.0 - 1000.0;
+			switch (i % 5)
+			{
+			case 0: corpus.append_sprintf("%.9g,", value); break;
+			case 1: corpus.append_sprintf("%.17g,", value / 1000.0); break;
+			case 2: corpus.append_sprintf("%.6f,", value / 1000.0); break;
+			case 3: corpus.append_sprintf("%.7e,", value * 1e-9); break;
+			case 4: corpus.append_sprintf("%llu,", (unsigned long long)(Random() % 1000000)); break;
+			}
+		}
+		return corpus;
+	}
+
+	// ***********************************************************************
+
+	typedef const char* (*NumberParseFunc)(const char*, const char*, ParsedNumber&);
+
+	double TimeNumberParsing(const eastl::string& corpus, NumberParseFunc parse, int iterations, eastl::vector<ParsedNumber>& outNumbers)
+	{
+		double bestTime = 1e30;
+		for (int i = 0; i < iterations; i++)
+		{
+			outNumbers.clear();
+			uint64_t start = SDL_GetPerformanceCounter();
+			const char* cursor = corpus.data();
+			const char* end = corpus.data() + corpus.size();
+			while (cursor < end)
+			{
+				ParsedNumber number;
+				cursor = parse(cursor, end, number) + 1; // Skip the comma
+				outNumbers.push_back(number);
+			}
+			bestTime = eastl::min(bestTime, SecondsSince(start));
+		}
+		return bestTime;
+	}
+
+	// ***********************************************************************
+
+	void BenchmarkNumberParsing()
+	{
+		const int numberCount = 1000000;
+		const int iterations = 10;
+		eastl::string corpus = MakeNumberCorpus(numberCount);
+		eastl::vector<ParsedNumber> strtodNumbers;
+		eastl::vector<ParsedNumber> fastNumbers;
+		strtodNumbers.reserve(numberCount);
+		fastNumbers.reserve(numberCount);
+
+		double strtodTime = TimeNumberParsing(corpus, ParseNumberStrtod, iterations, strtodNumbers);
+		double fastTime = TimeNumberParsing(corpus, ParseNumber, iterations, fastNumbers);
+
+		// Both paths must agree on every value, bit for bit
+		int mismatches = 0;
+		for (size_t i = 0; i < fastNumbers.size(); i++)
+		{
+			double expected = strtodNumbers[i].m_floating;
+			double actual = fastNumbers[i].m_isInteger ? (double)fastNumbers[i].m_integer : fastNumbers[i].m_floating;
+			if (memcmp(&expected, &actual, sizeof(double)) != 0)
+				mismatches++;
+		}
+
+		double megabytes = corpus.size() / (1024.0 * 1024.0);
+		printf("Number parsing, %d numbers, %.1f MB\n", numberCount, megabytes);
+		printf("    strtod       %8.2f ms %8.1f MB/s %6.1f ns/number\n", strtodTime * 1000.0, megabytes / strtodTime, strtodTime * 1e9 / numberCount);
+		printf("    ParseNumber  %8.2f ms %8.1f MB/s %6.1f ns/number\n", fastTime * 1000.0, megabytes / fastTime, fastTime * 1e9 / numberCount);
+		printf("    %.2fx faster, %d mismatches\n", strtodTime / fastTime, mismatches);
+	}
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	using namespace An;
+
+	// Expects to be run from the root of the repository. Pass a benchmark name to run only that one
+	bool runAll = argc < 2;
+	if (runAll || strcmp(argv[1], "numbers") == 0)
+		BenchmarkNumberParsing();
+	if (runAll || strcmp(argv[1], "json") == 0)
+		BenchmarkJson("Game/Assets");
+	return 0;
+}
@@ -0,0 +1,19 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <EASTL/string.h>
+#include <stdint.h>
+
+namespace An
+{
+    double SecondsSince(uint64_t startTime);
+
+    // Numbers shaped like the ones in gltf files, comma separated with a trailing comma
+    eastl::string MakeNumberCorpus(int count);
+
+    void BenchmarkNumberParsing();
+
+    // Runs the json benchmarks over every .gltf file in assetsDirectory, and a set of generated stress documents
+    void BenchmarkJson(const char* assetsDirectory);
+}
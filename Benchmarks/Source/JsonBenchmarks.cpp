@@ -0,0 +1,326 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "AllocationTracking.h"
+#include "Benchmarks.h"
+
+#include "Core/Json.h"
+#include "Core/JsonIncrementalParser.h"
+#include "Core/JsonLazy.h"
+#include "Core/Parallel.h"
+
+#include <EASTL/sort.h>
+#include <EASTL/string.h>
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+#include <SDL.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace An
+{
+	namespace
+	{
+		struct Corpus
+		{
+			eastl::string m_name;
+			eastl::string m_text;
+		};
+
+		struct Measurement
+		{
+			double m_seconds;
+			uint64_t m_allocations;
+			size_t m_peakBytes;
+		};
+
+		// Each operation is repeated until both of these are met, and the fastest run is kept
+		static constexpr int MinRuns = 3;
+		static constexpr double MinSeconds = 0.25;
+
+		static constexpr size_t ParallelChunkSize = 256 * 1024;
+		static constexpr size_t IncrementalChunkSize = 64 * 1024;
+
+		// ***********************************************************************
+
+		eastl::vector<eastl::string> ListFilesWithExtension(const char* directory, const char* extension)
+		{
+			eastl::vector<eastl::string> files;
+#if defined(_WIN32)
+			eastl::string pattern;
+			pattern.sprintf("%s/*%s", directory, extension);
+			WIN32_FIND_DATAA findData;
+			HANDLE handle = FindFirstFileA(pattern.c_str(), &findData);
+			if (handle == INVALID_HANDLE_VALUE)
+				return files;
+			do
+			{
+				files.push_back(eastl::string().sprintf("%s/%s", directory, findData.cFileName));
+			} while (FindNextFileA(handle, &findData));
+			FindClose(handle);
+#else
+			DIR* pDirectory = opendir(directory);
+			if (pDirectory == nullptr)
+				return files;
+			while (dirent* pEntry = readdir(pDirectory))
+			{
+				eastl::string_view name(pEntry->d_name);
+				if (name.size() > strlen(extension) && name.substr(name.size() - strlen(extension)) == extension)
+					files.push_back(eastl::string().sprintf("%s/%s", directory, pEntry->d_name));
+			}
+			closedir(pDirectory);
+#endif
+			eastl::sort(files.begin(), files.end());
+			return files;
+		}
+
+		// ***********************************************************************
+
+		bool ReadFile(const char* path, eastl::string& outText)
+		{
+			FILE* pFile = fopen(path, "rb");
+			if (pFile == nullptr)
+				return false;
+			fseek(pFile, 0, SEEK_END);
+			outText.resize(ftell(pFile));
+			fseek(pFile, 0, SEEK_SET);
+			size_t read = fread(outText.data(), 1, outText.size(), pFile);
+			fclose(pFile);
+			return read == outText.size();
+		}
+
+		// ***********************************************************************
+
+		// Arrays and objects nested hundreds deep, repeated to make up the size
+		eastl::string MakeDeepNestingCorpus()
+		{
+			const int depth = 500;
+			const int documents = 400;
+			eastl::string corpus = "[";
+			for (int i = 0; i < documents; i++)
+			{
+				for (int level = 0; level < depth; level++)
+					corpus.append(level % 2 ? "[" : "{\"child\": ");
+				corpus.append_sprintf("%d", i);
+				for (int level = depth - 1; level >= 0; level--)
+					corpus.append(level % 2 ? "]" : "}");
+				corpus.append(",\n");
+			}
+			corpus.append("]");
+			return corpus;
+		}
+
+		// ***********************************************************************
+
+		// One array of a million small objects, like a big scene or item database
+		eastl::string MakeHugeArrayCorpus()
+		{
+			const int count = 1000000;
+			eastl::string corpus = "[";
+			for (int i = 0; i < count; i++)
+				corpus.append_sprintf("{\"id\": %d, \"visible\": %s, \"parent\": null},", i, i % 3 ? "true" : "false");
+			corpus.append("]");
+			return corpus;
+		}
+
+		// ***********************************************************************
+
+		// Strings where a good fraction of the characters are escape sequences
+		eastl::string MakeEscapedStringCorpus()
+		{
+			const int count = 100000;
+			const char* fragments[] = { "line\\n", "\\ttabbed", "\\\"quoted\\\"", "back\\\\slash", "plain text ", "\\r\\n", "path\\/to\\/file" };
+			const int fragmentCount = sizeof(fragments) / sizeof(fragments[0]);
+
+			eastl::string corpus = "[";
+			for (int i = 0; i < count; i++)
+			{
+				corpus.append("\"");
+				for (int j = 0; j < 8; j++)
+					corpus.append(fragments[(i + j * 3) % fragmentCount]);
+				corpus.append("\",\n");
+			}
+			corpus.append("]");
+			return corpus;
+		}
+
+		// ***********************************************************************
+
+		// Rows of numbers, like accessor data or animation curves stored as text
+		eastl::string MakeNumberHeavyCorpus()
+		{
+			const int rows = 50000;
+			const int numbersPerRow = 20;
+			eastl::string numbers = MakeNumberCorpus(rows * numbersPerRow);
+
+			eastl::string corpus = "[";
+			const char* cursor = numbers.data();
+			for (int row = 0; row < rows; row++)
+			{
+				corpus.append("[");
+				for (int i = 0; i < numbersPerRow; i++)
+				{
+					const char* comma = strchr(cursor, ',');
+					corpus.append(cursor, comma + 1);
+					cursor = comma + 1;
+				}
+				corpus.append("],\n");
+			}
+			corpus.append("]");
+			return corpus;
+		}
+
+		// ***********************************************************************
+
+		// Visits every value, reading each one, so the whole tree has to be walked
+		uint64_t Traverse(const JsonValue& value)
+		{
+			switch (value.m_type)
+			{
+			case JsonValue::Object:
+			{
+				uint64_t sum = 0;
+				for (const JsonObject::value_type& member : *value.m_internalData.m_pObject)
+					sum += member.first.size() + Traverse(member.second);
+				return sum;
+			}
+			case JsonValue::Array:
+			{
+				uint64_t sum = 0;
+				for (const JsonValue& element : *value.m_internalData.m_pArray)
+					sum += Traverse(element);
+				return sum;
+			}
+			case JsonValue::String:
+				return value.ToString().size();
+			case JsonValue::Integer:
+				return (uint64_t)value.ToInt();
+			case JsonValue::Floating:
+				return (uint64_t)value.ToFloat();
+			case JsonValue::Boolean:
+				return value.ToBool();
+			default:
+				return 0;
+			}
+		}
+
+		// ***********************************************************************
+
+		// func returns whatever the operation produced, which is freed outside of the timed section, but is
+		// still alive when the peak memory is taken
+		template<typename Func>
+		Measurement Measure(Func func)
+		{
+			Measurement measurement;
+			{
+				ResetAllocationStats();
+				[[maybe_unused]] auto result = func();
+				AllocationStats stats = GetAllocationStats();
+				measurement.m_allocations = stats.m_count;
+				measurement.m_peakBytes = stats.m_peakBytes;
+			}
+
+			double bestTime = 1e30;
+			double totalTime = 0.0;
+			for (int runs = 0; runs < MinRuns || totalTime < MinSeconds; runs++)
+			{
+				uint64_t start = SDL_GetPerformanceCounter();
+				[[maybe_unused]] auto result = func();
+				double time = SecondsSince(start);
+				bestTime = eastl::min(bestTime, time);
+				totalTime += time;
+			}
+			measurement.m_seconds = bestTime;
+			return measurement;
+		}
+
+		// ***********************************************************************
+
+		void PrintMeasurement(const char* name, const Measurement& measurement, size_t textSize)
+		{
+			double megabytes = textSize / (1024.0 * 1024.0);
+			printf("    %-14s %9.3f ms %9.1f MB/s %10llu allocs %9.2f MB peak\n", name, measurement.m_seconds * 1000.0, megabytes / measurement.m_seconds,
+				(unsigned long long)measurement.m_allocations, measurement.m_peakBytes / (1024.0 * 1024.0));
+		}
+
+		// ***********************************************************************
+
+		void BenchmarkCorpus(const Corpus& corpus)
+		{
+			const eastl::string& text = corpus.m_text;
+			printf("%s, %.2f MB\n", corpus.m_name.c_str(), text.size() / (1024.0 * 1024.0));
+
+			Measurement parse = Measure([&]() { return ParseJsonFile(text.data(), text.size()); });
+			PrintMeasurement("Parse", parse, text.size());
+
+			JsonParseOptions parallelOptions;
+			parallelOptions.m_parallelChunkSize = ParallelChunkSize;
+			Measurement parallelParse = Measure([&]() { return ParseJsonFile(text.data(), text.size(), parallelOptions); });
+			PrintMeasurement("Parse parallel", parallelParse, text.size());
+
+			// As if the text were arriving from a file or pipe
+			Measurement chunkedParse = Measure([&]()
+			{
+				JsonIncrementalParser parser;
+				for (size_t offset = 0; offset < text.size(); offset += IncrementalChunkSize)
+					parser.Feed(text.data() + offset, eastl::min(IncrementalChunkSize, text.size() - offset));
+				JsonValue value;
+				parser.Finish(value);
+				return value;
+			});
+			PrintMeasurement("Parse chunked", chunkedParse, text.size());
+
+			// The arena takes its memory straight from malloc, so it's added on by hand
+			Measurement arenaParse = Measure([&]() { return eastl::make_unique<JsonDocument>(text.data(), text.size()); });
+			arenaParse.m_peakBytes += JsonDocument(text.data(), text.size()).m_arena.BytesReserved();
+			PrintMeasurement("Parse arena", arenaParse, text.size());
+
+			Measurement lazyParse = Measure([&]() { return eastl::make_unique<JsonLazyDocument>(text.data(), text.size()); });
+			PrintMeasurement("Parse lazy", lazyParse, text.size());
+
+			JsonValue value = ParseJsonFile(text.data(), text.size());
+
+			Measurement serialize = Measure([&]() { return SerializeJsonValue(value); });
+			PrintMeasurement("Serialize", serialize, text.size());
+
+			Measurement compact = Measure([&]() { return SerializeJsonValue(value, JsonWriter::Style::Compact); });
+			PrintMeasurement("Compact", compact, text.size());
+
+			uint64_t checksum = 0;
+			Measurement traverse = Measure([&]() { checksum += Traverse(value); return 0; });
+			PrintMeasurement("Traverse", traverse, text.size());
+		}
+	}
+
+	// ***********************************************************************
+
+	void BenchmarkJson(const char* assetsDirectory)
+	{
+		// Rates are always of the source text, so the same document's rows can be compared with each other
+		printf("Parallel parsing uses up to %u threads\n", HardwareThreadCount());
+		eastl::vector<Corpus> corpora;
+		for (const eastl::string& path : ListFilesWithExtension(assetsDirectory, ".gltf"))
+		{
+			Corpus corpus;
+			corpus.m_name = path;
+			if (ReadFile(path.c_str(), corpus.m_text))
+				corpora.push_back(eastl::move(corpus));
+		}
+		if (corpora.empty())
+			printf("No .gltf files found in %s, are the benchmarks running from the repository root?\n", assetsDirectory);
+
+		corpora.push_back({ "Deep nesting", MakeDeepNestingCorpus() });
+		corpora.push_back({ "Huge array", MakeHugeArrayCorpus() });
+		corpora.push_back({ "Escaped strings", MakeEscapedStringCorpus() });
+		corpora.push_back({ "Number heavy", MakeNumberHeavyCorpus() });
+
+		for (const Corpus& corpus : corpora)
+			BenchmarkCorpus(corpus);
+	}
+}
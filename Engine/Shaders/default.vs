@@ -5,9 +5,31 @@ $output v_texcoord0, v_color0, v_normal
 
 #include "common.sh"
 
+#if QUANTIZED_VERTICES
+// Position offset, position scale, then uv0 offset in xy and scale in zw, see Primitive::m_dequantize
+uniform vec4 u_dequantize[3];
+
+// Undoes Primitive's octahedral encoding, unfolding the lower half of the octahedron
+vec3 octahedralDecode(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0);
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.y += normal.y >= 0.0 ? -fold : fold;
+	return normalize(normal);
+}
+#endif
+
 void main()
 {
+#if QUANTIZED_VERTICES
+	vec3 position = u_dequantize[0].xyz + u_dequantize[1].xyz * a_position;
+	gl_Position = mul(u_modelViewProj, vec4(position, 1.0) );
+	v_texcoord0 = u_dequantize[2].xy + u_dequantize[2].zw * a_texcoord0;
+	v_normal = vec4(octahedralDecode(a_normal.xy), 1.0);
+#else
 	gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0) );
 	v_texcoord0 = a_texcoord0;
 	v_normal = a_normal;
+#endif
 }
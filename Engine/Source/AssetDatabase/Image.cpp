@@ -20,30 +20,95 @@ namespace An
         bimg::imageFree(pContainer);
     }
 
+    // ***********************************************************************
+
     Image::Image(Path path)
     {
+        if (Decode(path))
+            CreateGpuTexture();
+    }
+
+    // ***********************************************************************
+
+    Image::~Image()
+    {
+        if (m_pContainer)
+            bimg::imageFree(m_pContainer);
+        if (bgfx::isValid(m_gpuHandle))
+            bgfx::destroy(m_gpuHandle);
+    }
+
+    // ***********************************************************************
+
+    Image::Image(Image&& move)
+    {
+        *this = eastl::move(move);
+    }
+
+    // ***********************************************************************
+
+    Image& Image::operator=(Image&& move)
+    {
+        if (this == &move)
+            return *this;
+
+        if (m_pContainer)
+            bimg::imageFree(m_pContainer);
+        if (bgfx::isValid(m_gpuHandle))
+            bgfx::destroy(m_gpuHandle);
+
+        m_width = move.m_width;
+        m_height = move.m_height;
+        m_format = move.m_format;
+        m_path = eastl::move(move.m_path);
+        m_gpuHandle = move.m_gpuHandle;
+        m_pContainer = move.m_pContainer;
+
+        move.m_gpuHandle = BGFX_INVALID_HANDLE;
+        move.m_pContainer = nullptr;
+        return *this;
+    }
+
+    // ***********************************************************************
+
+    bool Image::Decode(Path path)
+    {
+        m_path = path;
         eastl::string file = FileSys::ReadWholeFile(path);
 
         static bx::DefaultAllocator allocator;
         bx::Error error;
-        bimg::ImageContainer* pContainer = bimg::imageParse(&allocator, file.data(), (uint32_t)file.size(), bimg::TextureFormat::Count, &error);
-
-        if (!bgfx::isTextureValid(0, false, pContainer->m_numLayers, bgfx::TextureFormat::Enum(pContainer->m_format), BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE))
+        m_pContainer = bimg::imageParse(&allocator, file.data(), (uint32_t)file.size(), bimg::TextureFormat::Count, &error);
+        if (m_pContainer == nullptr)
         {
             Log::Crit("Failed to load image %s", path.AsRawString());
-            return;
+            return false;
         }
 
-        m_width = pContainer->m_width;
-        m_height = pContainer->m_height;
-        m_format = bgfx::TextureFormat::Enum(pContainer->m_format);
-
-        const bgfx::Memory* mem = bgfx::makeRef(pContainer->m_data, pContainer->m_size, ImageFreeCallback, pContainer);
-        m_gpuHandle = bgfx::createTexture2D((uint16_t)m_width, (uint16_t)m_height, 1 < pContainer->m_numMips, pContainer->m_numLayers, m_format, BGFX_TEXTURE_NONE|BGFX_SAMPLER_NONE, mem);
+        m_width = m_pContainer->m_width;
+        m_height = m_pContainer->m_height;
+        m_format = bgfx::TextureFormat::Enum(m_pContainer->m_format);
+        return true;
     }
 
-    Image::~Image()
+    // ***********************************************************************
+
+    void Image::CreateGpuTexture()
     {
-        bgfx::destroy(m_gpuHandle);
+        if (m_pContainer == nullptr)
+            return;
+
+        if (!bgfx::isTextureValid(0, false, m_pContainer->m_numLayers, m_format, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE))
+        {
+            Log::Crit("Failed to load image %s", m_path.AsRawString());
+            bimg::imageFree(m_pContainer);
+            m_pContainer = nullptr;
+            return;
+        }
+
+        // bgfx frees the container once it's uploaded
+        const bgfx::Memory* mem = bgfx::makeRef(m_pContainer->m_data, m_pContainer->m_size, ImageFreeCallback, m_pContainer);
+        m_gpuHandle = bgfx::createTexture2D((uint16_t)m_width, (uint16_t)m_height, 1 < m_pContainer->m_numMips, m_pContainer->m_numLayers, m_format, BGFX_TEXTURE_NONE|BGFX_SAMPLER_NONE, mem);
+        m_pContainer = nullptr;
     }
 }
\ No newline at end of file
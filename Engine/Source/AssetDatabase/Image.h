@@ -6,6 +6,10 @@
 
 #include <bgfx/bgfx.h>
 
+namespace bimg
+{
+    struct ImageContainer;
+}
 
 namespace An
 {
@@ -15,9 +19,27 @@ namespace An
         Image(Path path);
         ~Image();
 
+        // Images own their decoded data and texture, so they can be moved but not copied
+        Image(const Image& copy) = delete;
+        Image& operator=(const Image& copy) = delete;
+        Image(Image&& move);
+        Image& operator=(Image&& move);
+
+        // Loading is split so the file reading and decoding can happen on any thread, but the texture has to be created
+        // on the thread that owns bgfx. Decode returns false, and logs why, if the image couldn't be loaded.
+        bool Decode(Path path);
+        void CreateGpuTexture();
+
+        // The file the image was decoded from
+        const Path& GetPath() const { return m_path; }
+
         int m_width;
         int m_height;
         bgfx::TextureFormat::Enum m_format;
-        bgfx::TextureHandle m_gpuHandle;
+        bgfx::TextureHandle m_gpuHandle{ BGFX_INVALID_HANDLE };
+
+    private:
+        Path m_path;
+        bimg::ImageContainer* m_pContainer{ nullptr }; // Decoded but not yet given to bgfx
     };
 }
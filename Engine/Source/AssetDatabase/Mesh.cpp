@@ -2,6 +2,11 @@
 
 #include "Mesh.h"
 
+#include "Core/Maths.h"
+
+#include <math.h>
+#include <string.h>
+
 namespace An
 {
      bgfx::VertexLayout Primitive::s_vertLayout;
@@ -18,7 +23,9 @@ namespace An
         m_normals = eastl::vector<Vec3f>(copy.m_normals);
         m_colors = eastl::vector<Vec4f>(copy.m_colors);
         m_indices = eastl::vector<uint16_t>(copy.m_indices);
+        m_name = copy.m_name;
         m_topologyType = copy.m_topologyType;
+        m_vertexFormat = copy.m_vertexFormat;
         m_localBounds = copy.m_localBounds;
         m_baseColorTexture = copy.m_baseColorTexture;
         m_baseColor = copy.m_baseColor;
@@ -35,10 +42,14 @@ namespace An
         m_normals = eastl::move(copy.m_normals);
         m_colors = eastl::move(copy.m_colors);
         m_indices = eastl::move(copy.m_indices);
+        m_name = eastl::move(copy.m_name);
         m_topologyType = copy.m_topologyType;
+        m_vertexFormat = copy.m_vertexFormat;
         m_localBounds = copy.m_localBounds;
         m_baseColorTexture = copy.m_baseColorTexture;
         m_baseColor = copy.m_baseColor;
+        for (int i = 0; i < 3; i++)
+            m_dequantize[i] = copy.m_dequantize[i];
 
         m_vertexBuffer = copy.m_vertexBuffer;
         m_uv0Buffer = copy.m_uv0Buffer;
@@ -70,7 +81,9 @@ namespace An
         m_normals = eastl::vector<Vec3f>(copy.m_normals);
         m_colors = eastl::vector<Vec4f>(copy.m_colors);
         m_indices = eastl::vector<uint16_t>(copy.m_indices);
+        m_name = copy.m_name;
         m_topologyType = copy.m_topologyType;
+        m_vertexFormat = copy.m_vertexFormat;
         m_localBounds = copy.m_localBounds;
         m_baseColorTexture = copy.m_baseColorTexture;
         m_baseColor = copy.m_baseColor;
@@ -88,10 +101,14 @@ namespace An
         m_normals = eastl::move(copy.m_normals);
         m_colors = eastl::move(copy.m_colors);
         m_indices = eastl::move(copy.m_indices);
+        m_name = eastl::move(copy.m_name);
         m_topologyType = copy.m_topologyType;
+        m_vertexFormat = copy.m_vertexFormat;
         m_localBounds = copy.m_localBounds;
         m_baseColorTexture = copy.m_baseColorTexture;
         m_baseColor = copy.m_baseColor;
+        for (int i = 0; i < 3; i++)
+            m_dequantize[i] = copy.m_dequantize[i];
 
         m_vertexBuffer = copy.m_vertexBuffer;
         m_uv0Buffer = copy.m_uv0Buffer;
@@ -198,34 +215,221 @@ namespace An
 
     void Primitive::CreateBuffers()
     {
-        if (!m_vertices.empty()) 
+        if (m_vertexFormat == VertexFormat::Interleaved)
         {
-	        uint32_t size = uint32_t(sizeof(Vec3f) * m_vertices.size());
-            m_vertexBuffer = bgfx::createVertexBuffer(bgfx::makeRef(m_vertices.data(), size), s_vertLayout);
+            CreateInterleavedVertexBuffer();
+        }
+        else if (m_vertexFormat == VertexFormat::Quantized)
+        {
+            CreateQuantizedVertexBuffer();
+        }
+        else
+        {
+            if (!m_vertices.empty()) 
+            {
+                uint32_t size = uint32_t(sizeof(Vec3f) * m_vertices.size());
+                m_vertexBuffer = bgfx::createVertexBuffer(bgfx::makeRef(m_vertices.data(), size), s_vertLayout);
+            }
+
+            if (!m_uv0.empty()) 
+            {
+                uint32_t size = uint32_t(sizeof(Vec2f) * m_uv0.size());
+                m_uv0Buffer = bgfx::createVertexBuffer(bgfx::makeRef(m_uv0.data(), size), s_uv0Layout);
+            }
+
+            if (!m_normals.empty()) 
+            {
+                uint32_t size = uint32_t(sizeof(Vec3f) * m_normals.size());
+                m_normalsBuffer = bgfx::createVertexBuffer(bgfx::makeRef(m_normals.data(), size), s_normLayout);
+            }
+
+            if (!m_colors.empty()) 
+            {
+                uint32_t size = uint32_t(sizeof(Vec4f) * m_colors.size());
+                m_colorBuffer = bgfx::createVertexBuffer(bgfx::makeRef(m_colors.data(), size), s_colLayout);
+            }
         }
 
-        if (!m_uv0.empty()) 
+        if (!m_indices.empty()) 
         {
-	        uint32_t size = uint32_t(sizeof(Vec2f) * m_uv0.size());
-            m_uv0Buffer = bgfx::createVertexBuffer(bgfx::makeRef(m_uv0.data(), size), s_uv0Layout);
+	        uint32_t size = uint32_t(sizeof(uint16_t) * m_indices.size());
+            m_indexBuffer = bgfx::createIndexBuffer(bgfx::makeRef(m_indices.data(), size));
         }
+    }
+
+	// ***********************************************************************
 
-        if (!m_normals.empty()) 
+    void Primitive::CreateInterleavedVertexBuffer()
+    {
+        if (m_vertices.empty())
+            return;
+
+        // The layout only has the attributes this primitive has. Attribute arrays are either empty or have one
+        // entry per vertex, anything else is left out rather than read past its end.
+        uint32_t vertexCount = (uint32_t)m_vertices.size();
+        bool hasUv0 = m_uv0.size() == vertexCount;
+        bool hasNormals = m_normals.size() == vertexCount;
+        bool hasColors = m_colors.size() == vertexCount;
+
+        bgfx::VertexLayout layout;
+        layout.begin().add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float);
+        if (hasUv0)
+            layout.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float);
+        if (hasNormals)
+            layout.add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float);
+        if (hasColors)
+            layout.add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Float);
+        layout.end();
+
+        // Written straight into memory bgfx owns, so there's no second copy of the vertices to keep alive
+        const bgfx::Memory* pMemory = bgfx::alloc(layout.getSize(vertexCount));
+        uint16_t stride = layout.getStride();
+        uint8_t* pVertex = pMemory->data;
+        for (uint32_t i = 0; i < vertexCount; i++, pVertex += stride)
         {
-	        uint32_t size = uint32_t(sizeof(Vec3f) * m_normals.size());
-            m_normalsBuffer = bgfx::createVertexBuffer(bgfx::makeRef(m_normals.data(), size), s_normLayout);
+            memcpy(pVertex, &m_vertices[i], sizeof(Vec3f));
+            if (hasUv0)
+                memcpy(pVertex + layout.getOffset(bgfx::Attrib::TexCoord0), &m_uv0[i], sizeof(Vec2f));
+            if (hasNormals)
+                memcpy(pVertex + layout.getOffset(bgfx::Attrib::Normal), &m_normals[i], sizeof(Vec3f));
+            if (hasColors)
+                memcpy(pVertex + layout.getOffset(bgfx::Attrib::Color0), &m_colors[i], sizeof(Vec4f));
         }
+        m_vertexBuffer = bgfx::createVertexBuffer(pMemory, layout);
+    }
+
+	// ***********************************************************************
 
-        if (!m_colors.empty()) 
+    namespace
+    {
+        // Maps -1 to 1 onto a normalized int16, which the GPU turns back into -1 to 1
+        int16_t QuantizeSnorm16(float value)
         {
-	        uint32_t size = uint32_t(sizeof(Vec4f) * m_colors.size());
-            m_colorBuffer = bgfx::createVertexBuffer(bgfx::makeRef(m_colors.data(), size), s_colLayout);
+            return (int16_t)lroundf(clamp(value, -1.0f, 1.0f) * 32767.0f);
         }
 
-        if (!m_indices.empty()) 
+        uint8_t QuantizeUnorm8(float value)
         {
-	        uint32_t size = uint32_t(sizeof(uint16_t) * m_indices.size());
-            m_indexBuffer = bgfx::createIndexBuffer(bgfx::makeRef(m_indices.data(), size));
+            return (uint8_t)lroundf(clamp(value, 0.0f, 1.0f) * 255.0f);
         }
+
+        // Folds the octahedron the unit sphere is projected onto out into a square, giving two values in -1 to 1.
+        // Cigolle et al, "A Survey of Efficient Representations for Independent Unit Vectors", 2014.
+        void OctahedralEncode(const Vec3f& normal, int16_t* pOutput)
+        {
+            float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+            float x = length > 0.0f ? normal.x / length : 0.0f;
+            float y = length > 0.0f ? normal.y / length : 0.0f;
+            if (normal.z < 0.0f)
+            {
+                float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = foldedX;
+                y = foldedY;
+            }
+            pOutput[0] = QuantizeSnorm16(x);
+            pOutput[1] = QuantizeSnorm16(y);
+        }
+    }
+
+	// ***********************************************************************
+
+    void Primitive::CreateQuantizedVertexBuffer()
+    {
+        if (m_vertices.empty())
+            return;
+
+        uint32_t vertexCount = (uint32_t)m_vertices.size();
+        bool hasUv0 = m_uv0.size() == vertexCount;
+        bool hasNormals = m_normals.size() == vertexCount;
+        bool hasColors = m_colors.size() == vertexCount;
+
+        // Positions and uv0s are stored relative to the range they cover, so all 16 bits go on that range
+        Vec3f positionMin(FLT_MAX), positionMax(-FLT_MAX);
+        for (const Vec3f& position : m_vertices)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                positionMin[i] = eastl::min(positionMin[i], position[i]);
+                positionMax[i] = eastl::max(positionMax[i], position[i]);
+            }
+        }
+        Vec2f uv0Min(0.0f), uv0Max(0.0f);
+        if (hasUv0)
+        {
+            uv0Min = Vec2f(FLT_MAX);
+            uv0Max = Vec2f(-FLT_MAX);
+            for (const Vec2f& uv : m_uv0)
+            {
+                uv0Min = Vec2f(eastl::min(uv0Min.x, uv.x), eastl::min(uv0Min.y, uv.y));
+                uv0Max = Vec2f(eastl::max(uv0Max.x, uv.x), eastl::max(uv0Max.y, uv.y));
+            }
+        }
+        Vec3f positionOffset = (positionMin + positionMax) * 0.5f;
+        Vec3f positionScale = (positionMax - positionMin) * 0.5f;
+        Vec2f uv0Offset = (uv0Min + uv0Max) * 0.5f;
+        Vec2f uv0Scale = (uv0Max - uv0Min) * 0.5f;
+        m_dequantize[0] = Vec4f(positionOffset.x, positionOffset.y, positionOffset.z, 0.0f);
+        m_dequantize[1] = Vec4f(positionScale.x, positionScale.y, positionScale.z, 0.0f);
+        m_dequantize[2] = Vec4f(uv0Offset.x, uv0Offset.y, uv0Scale.x, uv0Scale.y);
+
+        // A range of zero, like a flat axis, is stored as all zeroes
+        auto quantize = [](float value, float offset, float scale) { return QuantizeSnorm16(scale > 0.0f ? (value - offset) / scale : 0.0f); };
+
+        // Positions have a fourth unused component, as there are no three component 16 bit vertex formats
+        bgfx::VertexLayout layout;
+        layout.begin().add(bgfx::Attrib::Position, 4, bgfx::AttribType::Int16, true);
+        if (hasUv0)
+            layout.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Int16, true);
+        if (hasNormals)
+            layout.add(bgfx::Attrib::Normal, 2, bgfx::AttribType::Int16, true);
+        if (hasColors)
+            layout.add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Uint8, true);
+        layout.end();
+
+        const bgfx::Memory* pMemory = bgfx::alloc(layout.getSize(vertexCount));
+        uint16_t stride = layout.getStride();
+        uint8_t* pVertex = pMemory->data;
+        for (uint32_t i = 0; i < vertexCount; i++, pVertex += stride)
+        {
+            int16_t position[4];
+            for (int c = 0; c < 3; c++)
+                position[c] = quantize(m_vertices[i][c], positionOffset[c], positionScale[c]);
+            position[3] = 0;
+            memcpy(pVertex, position, sizeof(position));
+
+            if (hasUv0)
+            {
+                int16_t uv[2] = { quantize(m_uv0[i].x, uv0Offset.x, uv0Scale.x), quantize(m_uv0[i].y, uv0Offset.y, uv0Scale.y) };
+                memcpy(pVertex + layout.getOffset(bgfx::Attrib::TexCoord0), uv, sizeof(uv));
+            }
+            if (hasNormals)
+            {
+                int16_t normal[2];
+                OctahedralEncode(m_normals[i], normal);
+                memcpy(pVertex + layout.getOffset(bgfx::Attrib::Normal), normal, sizeof(normal));
+            }
+            if (hasColors)
+            {
+                uint8_t color[4];
+                for (int c = 0; c < 4; c++)
+                    color[c] = QuantizeUnorm8(m_colors[i][c]);
+                memcpy(pVertex + layout.getOffset(bgfx::Attrib::Color0), color, sizeof(color));
+            }
+        }
+        m_vertexBuffer = bgfx::createVertexBuffer(pMemory, layout);
+    }
+
+	// ***********************************************************************
+
+    void Primitive::SetBuffers() const
+    {
+        // Separate buffers are one stream each, in the same order as the interleaved layout
+        bgfx::setVertexBuffer(0, m_vertexBuffer);
+        if (bgfx::isValid(m_uv0Buffer))
+            bgfx::setVertexBuffer(1, m_uv0Buffer);
+        if (bgfx::isValid(m_normalsBuffer))
+            bgfx::setVertexBuffer(2, m_normalsBuffer);
+        bgfx::setIndexBuffer(m_indexBuffer);
     }
 }
\ No newline at end of file
@@ -23,6 +23,19 @@ namespace An
             PointList,
         };
 
+        // Separate gives each attribute its own vertex buffer, bound as its own stream. Interleaved puts every attribute
+        // the primitive has into one buffer, vertex after vertex, so each draw binds one buffer and a vertex's
+        // attributes are fetched together rather than from four places.
+        // Quantized is interleaved too, but packed into 20 bytes a vertex rather than 48. Positions and uv0s are 16 bit
+        // normalized integers covering the primitive's range, see m_dequantize, normals are octahedral encoded into two
+        // 16 bit integers, and colors are 8 bit. It has to be drawn with a vertex shader built with QUANTIZED_VERTICES.
+        enum class VertexFormat
+        {
+            Separate,
+            Interleaved,
+            Quantized,
+        };
+
         Primitive() {}
         Primitive(const Primitive& copy);
         Primitive(Primitive&& copy);
@@ -36,10 +49,18 @@ namespace An
         void RecalcLocalBounds();
         void CreateBuffers();
 
+        // Sets the vertex and index buffers for the next draw call, whichever format they were made in
+        void SetBuffers() const;
+
         eastl::string m_name{"Primitive"};
         TopologyType m_topologyType{TopologyType::TriangleList};
+        VertexFormat m_vertexFormat{VertexFormat::Interleaved};
         AABBf m_localBounds;
 
+        // How the vertex shader turns Quantized positions and uv0s back into their real values, which is offset + scale * value.
+        // Position offset, position scale, then uv0 offset in xy and scale in zw. Set by CreateBuffers, for u_dequantize.
+        Vec4f m_dequantize[3];
+
         Vec4f m_baseColor{ Vec4f(1.0f) };
         uint32_t m_baseColorTexture{ UINT32_MAX };
 
@@ -48,7 +69,7 @@ namespace An
         eastl::vector<Vec3f> m_normals;
         eastl::vector<Vec4f> m_colors;
         eastl::vector<uint16_t> m_indices{ nullptr };
-        bgfx::VertexBufferHandle m_vertexBuffer{ BGFX_INVALID_HANDLE };
+        bgfx::VertexBufferHandle m_vertexBuffer{ BGFX_INVALID_HANDLE }; // All the attributes when interleaved
         bgfx::VertexBufferHandle m_normalsBuffer{ BGFX_INVALID_HANDLE };
         bgfx::VertexBufferHandle m_uv0Buffer{ BGFX_INVALID_HANDLE };
         bgfx::VertexBufferHandle m_colorBuffer{ BGFX_INVALID_HANDLE };
@@ -58,6 +79,10 @@ namespace An
         static bgfx::VertexLayout s_normLayout;
         static bgfx::VertexLayout s_uv0Layout;
         static bgfx::VertexLayout s_colLayout;
+
+    private:
+        void CreateInterleavedVertexBuffer();
+        void CreateQuantizedVertexBuffer();
     };
 
     struct Mesh
@@ -0,0 +1,368 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "MeshOptimizer.h"
+
+#include "Mesh.h"
+
+#include <EASTL/sort.h>
+#include <EASTL/vector.h>
+
+namespace An
+{
+    namespace
+    {
+        // The triangles using each vertex, in one array with an offset per vertex
+        struct VertexTriangles
+        {
+            VertexTriangles(const uint16_t* pIndices, size_t indexCount, size_t vertexCount)
+            {
+                m_offsets.resize(vertexCount + 1, 0);
+                for (size_t i = 0; i < indexCount; i++)
+                    m_offsets[pIndices[i] + 1]++;
+                for (size_t v = 0; v < vertexCount; v++)
+                    m_offsets[v + 1] += m_offsets[v];
+
+                eastl::vector<uint32_t> cursors(m_offsets.begin(), m_offsets.end() - 1);
+                m_triangles.resize(indexCount);
+                for (size_t i = 0; i < indexCount; i++)
+                    m_triangles[cursors[pIndices[i]]++] = uint32_t(i / 3);
+            }
+
+            uint32_t Count(uint32_t vertex) const { return m_offsets[vertex + 1] - m_offsets[vertex]; }
+            const uint32_t* begin(uint32_t vertex) const { return m_triangles.data() + m_offsets[vertex]; }
+            const uint32_t* end(uint32_t vertex) const { return m_triangles.data() + m_offsets[vertex + 1]; }
+
+            eastl::vector<uint32_t> m_offsets;
+            eastl::vector<uint32_t> m_triangles;
+        };
+
+        // ***********************************************************************
+
+        // Tipsify's dead end, when the fanning vertex has no more triangles, continues from the most recently used vertex
+        // that still has some, or failing that the next vertex in order that does
+        uint32_t SkipDeadEnd(eastl::vector<uint32_t>& deadEnds, const eastl::vector<uint32_t>& liveTriangles, uint32_t& cursor)
+        {
+            while (!deadEnds.empty())
+            {
+                uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                    return vertex;
+            }
+            for (; cursor < liveTriangles.size(); cursor++)
+            {
+                if (liveTriangles[cursor] > 0)
+                    return cursor;
+            }
+            return UINT32_MAX;
+        }
+
+        // ***********************************************************************
+
+        // Emits every triangle around a fanning vertex, then moves on to whichever of their vertices will still be in
+        // the cache once its own triangles are emitted, preferring the one that's been in it longest. Clusters start
+        // wherever there was a dead end, which are the places the order can be changed without hurting the cache.
+        void Tipsify(const uint16_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, eastl::vector<uint32_t>& outTriangles, eastl::vector<uint32_t>& outClusterStarts)
+        {
+            VertexTriangles adjacency(pIndices, indexCount, vertexCount);
+            eastl::vector<uint32_t> liveTriangles(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++)
+                liveTriangles[v] = adjacency.Count(v);
+
+            eastl::vector<uint32_t> cacheTimes(vertexCount, 0);
+            eastl::vector<uint8_t> emitted(indexCount / 3, 0);
+            eastl::vector<uint32_t> deadEnds;
+            eastl::vector<uint32_t> candidates;
+            uint32_t time = cacheSize + 1;
+            uint32_t cursor = 0;
+
+            outTriangles.reserve(indexCount / 3);
+            outClusterStarts.push_back(0);
+            uint32_t fanning = 0;
+            while (fanning != UINT32_MAX)
+            {
+                candidates.clear();
+                for (const uint32_t* pTriangle = adjacency.begin(fanning); pTriangle != adjacency.end(fanning); pTriangle++)
+                {
+                    if (emitted[*pTriangle])
+                        continue;
+
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t vertex = pIndices[*pTriangle * 3 + k];
+                        deadEnds.push_back(vertex);
+                        candidates.push_back(vertex);
+                        liveTriangles[vertex]--;
+                        if (time - cacheTimes[vertex] > cacheSize)
+                            cacheTimes[vertex] = time++;
+                    }
+                    emitted[*pTriangle] = 1;
+                    outTriangles.push_back(*pTriangle);
+                }
+
+                uint32_t next = UINT32_MAX;
+                int bestPriority = -1;
+                for (uint32_t vertex : candidates)
+                {
+                    if (liveTriangles[vertex] == 0)
+                        continue;
+
+                    int priority = 0;
+                    if (time - cacheTimes[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                        priority = int(time - cacheTimes[vertex]);
+                    if (priority > bestPriority)
+                    {
+                        bestPriority = priority;
+                        next = vertex;
+                    }
+                }
+
+                if (next == UINT32_MAX)
+                {
+                    if (outClusterStarts.back() != outTriangles.size())
+                        outClusterStarts.push_back((uint32_t)outTriangles.size());
+                    next = SkipDeadEnd(deadEnds, liveTriangles, cursor);
+                }
+                fanning = next;
+            }
+
+            if (outClusterStarts.back() == outTriangles.size())
+                outClusterStarts.pop_back();
+        }
+
+        // ***********************************************************************
+
+        // Clusters from Tipsify can be big, so they're split further wherever the cluster so far has an ACMR within the
+        // threshold of the whole mesh's. Each cluster then stays efficient even when it's drawn after something else.
+        eastl::vector<uint32_t> SplitClusters(const uint16_t* pIndices, size_t indexCount, size_t vertexCount, const eastl::vector<uint32_t>& clusterStarts, uint32_t cacheSize, float threshold)
+        {
+            float meshAcmr = AnalyzeVertexCache(pIndices, indexCount, vertexCount, cacheSize).Acmr();
+            uint32_t triangleCount = uint32_t(indexCount / 3);
+
+            eastl::vector<uint32_t> cacheTimes(vertexCount, 0);
+            uint32_t time = cacheSize + 1;
+
+            eastl::vector<uint32_t> splitStarts;
+            for (size_t cluster = 0; cluster < clusterStarts.size(); cluster++)
+            {
+                uint32_t end = cluster + 1 < clusterStarts.size() ? clusterStarts[cluster + 1] : triangleCount;
+                uint32_t start = clusterStarts[cluster];
+                splitStarts.push_back(start);
+
+                uint32_t misses = 0;
+                time += cacheSize + 1; // Empties the cache
+                for (uint32_t triangle = start; triangle < end; triangle++)
+                {
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t vertex = pIndices[triangle * 3 + k];
+                        if (time - cacheTimes[vertex] > cacheSize)
+                        {
+                            cacheTimes[vertex] = time++;
+                            misses++;
+                        }
+                    }
+
+                    if (triangle + 1 < end && misses <= threshold * meshAcmr * (triangle + 1 - start))
+                    {
+                        splitStarts.push_back(triangle + 1);
+                        start = triangle + 1;
+                        misses = 0;
+                        time += cacheSize + 1;
+                    }
+                }
+            }
+            return splitStarts;
+        }
+
+        // ***********************************************************************
+
+        // Clusters facing away from the middle of the mesh are drawn first, as they're the ones most likely to cover the
+        // others. Gives the new order of triangles.
+        eastl::vector<uint32_t> SortClustersForOverdraw(const uint16_t* pIndices, size_t indexCount, const eastl::vector<Vec3f>& positions, const eastl::vector<uint32_t>& clusterStarts)
+        {
+            uint32_t triangleCount = uint32_t(indexCount / 3);
+
+            struct Cluster
+            {
+                uint32_t m_start;
+                uint32_t m_end;
+                Vec3f m_centroid;
+                Vec3f m_normal;
+                float m_area;
+                float m_sortKey;
+            };
+
+            // Centroids are area weighted, so a scattering of tiny triangles doesn't pull them about
+            eastl::vector<Cluster> clusters;
+            Vec3f meshCentroid(0.0f);
+            float meshArea = 0.0f;
+            for (size_t i = 0; i < clusterStarts.size(); i++)
+            {
+                Cluster cluster;
+                cluster.m_start = clusterStarts[i];
+                cluster.m_end = i + 1 < clusterStarts.size() ? clusterStarts[i + 1] : triangleCount;
+                cluster.m_centroid = Vec3f(0.0f);
+                cluster.m_normal = Vec3f(0.0f);
+                cluster.m_area = 0.0f;
+                for (uint32_t triangle = cluster.m_start; triangle < cluster.m_end; triangle++)
+                {
+                    const Vec3f& a = positions[pIndices[triangle * 3]];
+                    const Vec3f& b = positions[pIndices[triangle * 3 + 1]];
+                    const Vec3f& c = positions[pIndices[triangle * 3 + 2]];
+                    Vec3f normal = Vec3f::Cross(b - a, c - a);
+                    float area = normal.GetLength();
+                    cluster.m_normal = cluster.m_normal + normal;
+                    cluster.m_centroid = cluster.m_centroid + (a + b + c) * (area / 3.0f);
+                    cluster.m_area += area;
+                }
+                meshCentroid = meshCentroid + cluster.m_centroid;
+                meshArea += cluster.m_area;
+                clusters.push_back(cluster);
+            }
+            if (meshArea <= 0.0f)
+                meshArea = 1.0f;
+            meshCentroid = meshCentroid * (1.0f / meshArea);
+
+            for (Cluster& cluster : clusters)
+            {
+                float normalLength = cluster.m_normal.GetLength();
+                if (cluster.m_area > 0.0f && normalLength > 0.0f)
+                    cluster.m_sortKey = Vec3f::Dot(cluster.m_centroid * (1.0f / cluster.m_area) - meshCentroid, cluster.m_normal * (1.0f / normalLength));
+                else
+                    cluster.m_sortKey = 0.0f;
+            }
+            eastl::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.m_sortKey > b.m_sortKey; });
+
+            eastl::vector<uint32_t> triangles;
+            triangles.reserve(triangleCount);
+            for (const Cluster& cluster : clusters)
+            {
+                for (uint32_t triangle = cluster.m_start; triangle < cluster.m_end; triangle++)
+                    triangles.push_back(triangle);
+            }
+            return triangles;
+        }
+
+        // ***********************************************************************
+
+        void ReorderTriangles(eastl::vector<uint16_t>& indices, const eastl::vector<uint32_t>& triangles)
+        {
+            eastl::vector<uint16_t> reordered(triangles.size() * 3);
+            for (size_t i = 0; i < triangles.size(); i++)
+            {
+                for (int k = 0; k < 3; k++)
+                    reordered[i * 3 + k] = indices[triangles[i] * 3 + k];
+            }
+            indices = eastl::move(reordered);
+        }
+
+        // ***********************************************************************
+
+        template<typename T>
+        void RemapVertices(eastl::vector<T>& attribute, const eastl::vector<uint32_t>& remap, uint32_t newCount)
+        {
+            // Attributes the primitive doesn't have are empty
+            if (attribute.size() != remap.size())
+                return;
+
+            eastl::vector<T> remapped(newCount);
+            for (size_t v = 0; v < remap.size(); v++)
+            {
+                if (remap[v] != UINT32_MAX)
+                    remapped[remap[v]] = attribute[v];
+            }
+            attribute = eastl::move(remapped);
+        }
+    }
+
+    // ***********************************************************************
+
+    VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other)
+    {
+        m_triangleCount += other.m_triangleCount;
+        m_vertexCount += other.m_vertexCount;
+        m_cacheMisses += other.m_cacheMisses;
+        return *this;
+    }
+
+    // ***********************************************************************
+
+    VertexCacheStats AnalyzeVertexCache(const uint16_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        // A vertex is in the cache if fewer than cacheSize others have been added since it was
+        eastl::vector<uint32_t> cacheTimes(vertexCount, 0);
+        eastl::vector<uint8_t> used(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+
+        VertexCacheStats stats;
+        stats.m_triangleCount = uint32_t(indexCount / 3);
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            uint32_t vertex = pIndices[i];
+            if (time - cacheTimes[vertex] > cacheSize)
+            {
+                cacheTimes[vertex] = time++;
+                stats.m_cacheMisses++;
+            }
+            stats.m_vertexCount += used[vertex] == 0;
+            used[vertex] = 1;
+        }
+        return stats;
+    }
+
+    // ***********************************************************************
+
+    MeshOptimizeResult OptimizePrimitive(Primitive& prim, const MeshOptimizeOptions& options)
+    {
+        eastl::vector<uint16_t>& indices = prim.m_indices;
+        size_t vertexCount = prim.m_vertices.size();
+
+        // Anything that isn't an indexed triangle list, or has indices out of range, is left as it is
+        bool isValid = prim.m_topologyType == Primitive::TopologyType::TriangleList && !indices.empty() && indices.size() % 3 == 0;
+        for (size_t i = 0; i < indices.size() && isValid; i++)
+            isValid = indices[i] < vertexCount;
+
+        MeshOptimizeResult result;
+        if (!isValid)
+        {
+            result.m_before = result.m_after = AnalyzeVertexCache(indices.data(), indices.size(), eastl::max(vertexCount, size_t(UINT16_MAX) + 1), options.m_cacheSize);
+            return result;
+        }
+        result.m_before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, options.m_cacheSize);
+
+        eastl::vector<uint32_t> triangles;
+        eastl::vector<uint32_t> clusterStarts;
+        Tipsify(indices.data(), indices.size(), vertexCount, options.m_cacheSize, triangles, clusterStarts);
+        ReorderTriangles(indices, triangles);
+
+        if (options.m_optimizeOverdraw && clusterStarts.size() > 1)
+        {
+            // Cluster starts were in the order Tipsify emitted triangles, which is now the order of the indices. Each
+            // cluster starts with a cold cache, so the sorted order is only kept if it stays within the threshold.
+            float tipsifyAcmr = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, options.m_cacheSize).Acmr();
+            clusterStarts = SplitClusters(indices.data(), indices.size(), vertexCount, clusterStarts, options.m_cacheSize, options.m_overdrawThreshold);
+            eastl::vector<uint16_t> sorted = indices;
+            ReorderTriangles(sorted, SortClustersForOverdraw(indices.data(), indices.size(), prim.m_vertices, clusterStarts));
+            if (AnalyzeVertexCache(sorted.data(), sorted.size(), vertexCount, options.m_cacheSize).Acmr() <= tipsifyAcmr * options.m_overdrawThreshold)
+                indices = eastl::move(sorted);
+        }
+
+        // Vertices are numbered in the order they're first used, so fetching them walks forward through memory
+        eastl::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        uint32_t newCount = 0;
+        for (uint16_t& index : indices)
+        {
+            if (remap[index] == UINT32_MAX)
+                remap[index] = newCount++;
+            index = (uint16_t)remap[index];
+        }
+        RemapVertices(prim.m_vertices, remap, newCount);
+        RemapVertices(prim.m_normals, remap, newCount);
+        RemapVertices(prim.m_uv0, remap, newCount);
+        RemapVertices(prim.m_colors, remap, newCount);
+
+        result.m_after = AnalyzeVertexCache(indices.data(), indices.size(), newCount, options.m_cacheSize);
+        return result;
+    }
+}
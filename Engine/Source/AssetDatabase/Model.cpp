@@ -1,26 +1,39 @@
 #include "Model.h"
 
-#include "Core/Json.h"
+#include "MeshOptimizer.h"
+#include "SceneCooker.h"
+#include "Core/Hash.h"
+#include "Core/JsonLazy.h"
+#include "Core/JsonQuery.h"
 #include "Core/Base64.h"
 #include "Core/Log.h"
+#include "Core/MappedFile.h"
+#include "Core/Parallel.h"
+#include "Core/Scanning.h"
 
-#include <SDL_rwops.h>
+#include <EASTL/hash_map.h>
+#include <EASTL/unique_ptr.h>
+#include <EASTL/weak_ptr.h>
+#include <atomic>
+#include <mutex>
 
 namespace An
 {
-    // Actually owns the data
+    // Owns the data if it had to be decoded, a glb's binary chunk and external files are used in place
     struct Buffer
     {
-        char* pBytes{ nullptr };
+        const char* pBytes{ nullptr };
         size_t byteLength{ 0 };
+        eastl::unique_ptr<char[]> pOwnedBytes;
     };
 
     // Does not actually own the data
     struct BufferView
     {
         // pointer to some place in a buffer
-        char* pBuffer{ nullptr };
+        const char* pBuffer{ nullptr };
         size_t length{ 0 };
+        size_t byteStride{ 0 }; // 0 when the elements are tightly packed
 
         enum Target
         {
@@ -33,8 +46,10 @@ namespace An
     struct Accessor
     {
         // pointer to some place in a buffer view
-        char* pBuffer{ nullptr };
+        const char* pBuffer{ nullptr };
         int count{ 0 };
+        size_t stride{ 0 }; // Bytes from one element to the next
+        bool normalized{ false }; // Integers map to 0 to 1, or -1 to 1 if signed, rather than being converted as they are
         enum ComponentType
         {
             Byte,
@@ -44,7 +59,7 @@ namespace An
             UInt,
             Float
         };
-        ComponentType componentType;
+        ComponentType componentType{ Float };
 
         enum Type
         {
@@ -56,21 +71,241 @@ namespace An
             Mat3,
             Mat4
         };
-        Type type;
+        Type type{ Scalar };
     };
 
-    void ParseNodesRecursively(Node* pParent, eastl::vector<Node>& outNodes, JsonValue& nodeToParse, JsonValue& nodesData)
+    int ComponentSize(Accessor::ComponentType componentType)
+    {
+        static const int sizes[] = { 1, 1, 2, 2, 4, 4 };
+        return sizes[componentType];
+    }
+
+    int ComponentCount(Accessor::Type type)
+    {
+        static const int counts[] = { 1, 2, 3, 4, 4, 9, 16 };
+        return counts[type];
+    }
+
+    // Reads up to components floats per element into pOutput, converting from the accessor's component type the way the
+    // gltf spec says to. Attributes can be bytes or shorts, normalized or not, with KHR_mesh_quantization, which also
+    // pads them out with byteStride. Components the accessor doesn't have are left as they were, so callers can
+    // default them, like the alpha of a color with only rgb.
+    void ReadAccessorFloats(const Accessor& accessor, int components, float* pOutput)
+    {
+        int accessorComponents = ComponentCount(accessor.type);
+        if (accessor.componentType == Accessor::Float && accessorComponents == components && accessor.stride == components * sizeof(float))
+        {
+            memcpy(pOutput, accessor.pBuffer, accessor.count * accessor.stride);
+            return;
+        }
+
+        int readComponents = eastl::min(accessorComponents, components);
+        int componentSize = ComponentSize(accessor.componentType);
+        for (int i = 0; i < accessor.count; i++)
+        {
+            const char* pElement = accessor.pBuffer + i * accessor.stride;
+            float* pValues = pOutput + i * components;
+            for (int c = 0; c < readComponents; c++)
+            {
+                const char* pComponent = pElement + c * componentSize;
+                switch (accessor.componentType)
+                {
+                case Accessor::Byte:
+                {
+                    int8_t value; memcpy(&value, pComponent, sizeof(value));
+                    pValues[c] = accessor.normalized ? eastl::max(value / 127.0f, -1.0f) : float(value);
+                    break;
+                }
+                case Accessor::UByte:
+                {
+                    uint8_t value; memcpy(&value, pComponent, sizeof(value));
+                    pValues[c] = accessor.normalized ? value / 255.0f : float(value);
+                    break;
+                }
+                case Accessor::Short:
+                {
+                    int16_t value; memcpy(&value, pComponent, sizeof(value));
+                    pValues[c] = accessor.normalized ? eastl::max(value / 32767.0f, -1.0f) : float(value);
+                    break;
+                }
+                case Accessor::UShort:
+                {
+                    uint16_t value; memcpy(&value, pComponent, sizeof(value));
+                    pValues[c] = accessor.normalized ? value / 65535.0f : float(value);
+                    break;
+                }
+                case Accessor::UInt:
+                {
+                    uint32_t value; memcpy(&value, pComponent, sizeof(value));
+                    pValues[c] = float(value);
+                    break;
+                }
+                case Accessor::Float:
+                    memcpy(&pValues[c], pComponent, sizeof(float));
+                    break;
+                }
+            }
+        }
+    }
+
+    // Indices can be bytes, shorts or ints, but are stored as shorts, which callers check the vertex count fits in.
+    // Returns false if any index isn't below vertexCount.
+    bool ReadAccessorIndices(const Accessor& accessor, uint32_t vertexCount, uint16_t* pOutput)
+    {
+        for (int i = 0; i < accessor.count; i++)
+        {
+            const char* pElement = accessor.pBuffer + i * accessor.stride;
+            uint32_t index;
+            switch (accessor.componentType)
+            {
+            case Accessor::UByte:
+            {
+                uint8_t value; memcpy(&value, pElement, sizeof(value));
+                index = value;
+                break;
+            }
+            case Accessor::UShort:
+            {
+                uint16_t value; memcpy(&value, pElement, sizeof(value));
+                index = value;
+                break;
+            }
+            default:
+                memcpy(&index, pElement, sizeof(index));
+                break;
+            }
+
+            if (index >= vertexCount)
+                return false;
+            pOutput[i] = (uint16_t)index;
+        }
+        return true;
+    }
+
+    // Where one primitive's attributes are, found while reading the json so they can be copied out on a worker thread
+    struct PrimitiveSource
+    {
+        const Accessor* pPositions{ nullptr };
+        const Accessor* pNormals{ nullptr };
+        const Accessor* pUv0{ nullptr };
+        const Accessor* pColors{ nullptr };
+        const Accessor* pIndices{ nullptr }; // Primitives without indices draw their vertices in order
+    };
+
+    // Binary gltf is a 12 byte header, then a json chunk, then optionally a binary chunk which is buffer 0.
+    // Everything is little endian, and chunks are padded to keep them 4 byte aligned.
+    struct GlbChunks
+    {
+        const char* pJson{ nullptr };
+        size_t jsonLength{ 0 };
+        const char* pBin{ nullptr };
+        size_t binLength{ 0 };
+    };
+
+    bool IsGlb(const char* pData, size_t size)
+    {
+        return size >= 4 && memcmp(pData, "glTF", 4) == 0;
+    }
+
+    bool ReadGlbChunks(const char* pData, size_t size, const Path& path, GlbChunks& outChunks)
+    {
+        auto readUint32 = [pData](size_t offset) { uint32_t value; memcpy(&value, pData + offset, sizeof(value)); return value; };
+
+        if (size < 20 || readUint32(4) != 2)
+        {
+            Log::Crit("%s is not a version 2 binary gltf file", path.AsRawString());
+            return false;
+        }
+
+        size_t length = eastl::min((size_t)readUint32(8), size);
+        size_t offset = 12;
+        while (length - offset >= 8)
+        {
+            size_t chunkLength = readUint32(offset);
+            uint32_t chunkType = readUint32(offset + 4);
+            offset += 8;
+            if (chunkLength > length - offset)
+            {
+                Log::Crit("%s has a chunk that runs past the end of the file", path.AsRawString());
+                return false;
+            }
+
+            // Other chunk types are extensions, which are skipped
+            if (chunkType == 0x4e4f534a && outChunks.pJson == nullptr) // "JSON"
+            {
+                outChunks.pJson = pData + offset;
+                outChunks.jsonLength = chunkLength;
+            }
+            else if (chunkType == 0x004e4942 && outChunks.pBin == nullptr) // "BIN\0"
+            {
+                outChunks.pBin = pData + offset;
+                outChunks.binLength = chunkLength;
+            }
+            offset += eastl::min((chunkLength + 3) & ~size_t(3), length - offset);
+        }
+
+        if (outChunks.pJson == nullptr)
+        {
+            Log::Crit("%s has no json chunk", path.AsRawString());
+            return false;
+        }
+        return true;
+    }
+
+    // External buffer files stay mapped for as long as a scene using them is alive, and scenes that share a file
+    // share the mapping too, so it's only read once. Scenes can load on any thread, hence the lock.
+    eastl::shared_ptr<MappedFile> MapBufferFile(const Path& path)
+    {
+        static std::mutex mutex;
+        static eastl::hash_map<eastl::string, eastl::weak_ptr<MappedFile>> mappedFiles;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        eastl::weak_ptr<MappedFile>& cached = mappedFiles[path.AsString()];
+        eastl::shared_ptr<MappedFile> pFile = cached.lock();
+        if (pFile == nullptr)
+        {
+            pFile = eastl::make_shared<MappedFile>(path);
+            if (!pFile->IsValid())
+                return nullptr;
+            cached = pFile;
+        }
+        return pFile;
+    }
+
+    // Uris can percent encode characters, e.g. spaces as %20
+    eastl::string DecodeUri(eastl::string_view uri)
+    {
+        auto hexValue = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+
+        eastl::string decoded;
+        decoded.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); i++)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && Scan::IsHexDigit(uri[i + 1]) && Scan::IsHexDigit(uri[i + 2]))
+            {
+                decoded.push_back(char(hexValue(uri[i + 1]) << 4 | hexValue(uri[i + 2])));
+                i += 2;
+            }
+            else
+            {
+                decoded.push_back(uri[i]);
+            }
+        }
+        return decoded;
+    }
+
+    void ParseNodesRecursively(Node* pParent, eastl::vector<Node>& outNodes, JsonLazyValue nodeToParse, JsonLazyValue nodesData)
     {
         for (int i = 0; i < nodeToParse.Count(); i++)
         {
             int nodeId = nodeToParse[i].ToInt();
-            JsonValue& jsonNode = nodesData[nodeId];
+            JsonLazyValue jsonNode = nodesData[nodeId];
 
             // extract the nodes
             outNodes.emplace_back();
             Node& node = outNodes.back();
 
-            node.m_name = jsonNode.HasKey("name") ? jsonNode["name"].ToString() : "";
+            node.m_name = jsonNode.HasKey("name") ? eastl::string(jsonNode["name"].ToString()) : "";
             node.m_meshId = UINT32_MAX;
 
             if (jsonNode.HasKey("children"))
@@ -127,46 +362,144 @@ namespace An
 
     Scene::Scene(Path path)
     {
-        SDL_RWops* pFileRead = SDL_RWFromFile(path.AsRawString(), "rb");
+        if (Import(path))
+            CreateGpuResources();
+    }
 
-        uint64_t size = SDL_RWsize(pFileRead);
-        char* pData = new char[size];
-        SDL_RWread(pFileRead, pData, size, 1);
-        SDL_RWclose(pFileRead);
+    // ***********************************************************************
 
-        eastl::string file(pData, pData + size);
+    bool Scene::Import(Path path)
+    {
+        MappedFile file(path);
+        if (!file.IsValid())
+            return false;
+
+        // Hashing is much quicker than importing, so the cooked scene is used whenever the source still matches it
+        uint64_t sourceHash = HashBytes(file.Data(), file.Size());
+        Path cookedPath = CookedScenePath(path);
+        if (LoadCookedScene(cookedPath, sourceHash, *this))
+            return true;
+
+        eastl::vector<Path> bufferPaths;
+        if (!ImportGltf(path, file, bufferPaths))
+            return false;
+
+        CookScene(*this, sourceHash, bufferPaths, cookedPath);
+        return true;
+    }
+
+    // ***********************************************************************
+
+    bool Scene::ImportGltf(const Path& path, const MappedFile& file, eastl::vector<Path>& outBufferPaths)
+    {
+        // Text gltf is json from start to end, a glb's json and binary data are in chunks that are used where they are
+        GlbChunks chunks;
+        if (IsGlb(file.Data(), file.Size()))
+        {
+            if (!ReadGlbChunks(file.Data(), file.Size(), path, chunks))
+                return false;
+        }
+        else
+        {
+            chunks.pJson = file.Data();
+            chunks.jsonLength = file.Size();
+        }
 
-        JsonValue parsed = ParseJsonFile(file);
+        // Only the parts of the document we read get parsed, and strings point into the mapping, so it's kept open until we're done with the json
+        JsonLazyDocument document(chunks.pJson, chunks.jsonLength);
+        JsonLazyValue parsed = document.Root();
 
         bool validGltf = parsed["asset"]["version"].ToString() == "2.0";
         if (!validGltf)
-            return;
+            return false;
 
         eastl::vector<Buffer> rawDataBuffers;
-        JsonValue& jsonBuffers = parsed["buffers"];
+        JsonLazyValue jsonBuffers = parsed["buffers"];
         for (int i = 0; i < jsonBuffers.Count(); i++)
         {
             Buffer buf;
-            buf.byteLength = jsonBuffers[i]["byteLength"].ToInt();
-            buf.pBytes = new char[buf.byteLength];
-            
-            eastl::string encodedBuffer = jsonBuffers[i]["uri"].ToString().substr(37);
-            memcpy(buf.pBytes, DecodeBase64(encodedBuffer).data(), buf.byteLength);
+            int64_t byteLength = jsonBuffers[i]["byteLength"].ToInt();
+            if (byteLength < 0)
+            {
+                Log::Crit("Buffer %i of %s has a negative byteLength", i, path.AsRawString());
+                return false;
+            }
+            buf.byteLength = (size_t)byteLength;
+
+            if (!jsonBuffers[i].HasKey("uri"))
+            {
+                // Only a glb's first buffer can leave out the uri, it's the binary chunk, which can have up to 3 bytes of padding
+                if (i != 0 || chunks.pBin == nullptr || chunks.binLength < buf.byteLength)
+                {
+                    Log::Crit("Buffer %i of %s has no uri, and there's no binary chunk big enough for it", i, path.AsRawString());
+                    return false;
+                }
+                buf.pBytes = chunks.pBin;
+                rawDataBuffers.push_back(eastl::move(buf));
+                continue;
+            }
 
-            rawDataBuffers.push_back(buf);
+            eastl::string_view uri = jsonBuffers[i]["uri"].ToString();
+            if (!uri.starts_with("data:"))
+            {
+                // Anything that isn't a data uri is a file relative to the gltf
+                Path bufferPath = path.ParentPath() / Path(DecodeUri(uri));
+                eastl::shared_ptr<MappedFile> pFile = MapBufferFile(bufferPath);
+                if (pFile == nullptr)
+                    return false;
+                if (pFile->Size() < buf.byteLength)
+                {
+                    Log::Crit("Buffer %i of %s is meant to have %zu bytes, but %.*s only has %zu", i, path.AsRawString(), buf.byteLength, (int)uri.size(), uri.data(), pFile->Size());
+                    return false;
+                }
+                buf.pBytes = pFile->Data();
+                m_bufferFiles.push_back(eastl::move(pFile));
+                outBufferPaths.push_back(bufferPath);
+                rawDataBuffers.push_back(eastl::move(buf));
+                continue;
+            }
+
+            // Embedded buffers are data uris, the base64 is everything after the comma in "data:application/octet-stream;base64,"
+            eastl::string_view encoded = uri.substr(uri.find(',') + 1);
+            size_t decodedLength = DecodedBase64Length(encoded.data(), encoded.size());
+            buf.pOwnedBytes.reset(new char[eastl::max(buf.byteLength, decodedLength)]);
+            if (!DecodeBase64IntoParallel(encoded.data(), encoded.size(), buf.pOwnedBytes.get()))
+            {
+                Log::Crit("Buffer %i of %s has an invalid data uri", i, path.AsRawString());
+                return false;
+            }
+            if (decodedLength < buf.byteLength)
+            {
+                Log::Warn("Buffer %i of %s has %zu bytes, but is meant to have %zu", i, path.AsRawString(), decodedLength, buf.byteLength);
+                memset(buf.pOwnedBytes.get() + decodedLength, 0, buf.byteLength - decodedLength);
+            }
+            buf.pBytes = buf.pOwnedBytes.get();
+
+            rawDataBuffers.push_back(eastl::move(buf));
         }
 
         eastl::vector<BufferView> bufferViews;
-        JsonValue& jsonBufferViews = parsed["bufferViews"];
+        JsonLazyValue jsonBufferViews = parsed["bufferViews"];
 
         for (int i = 0; i < jsonBufferViews.Count(); i++)
         {
             BufferView view;
 
-            int bufIndex = jsonBufferViews[i]["buffer"].ToInt();
-            view.pBuffer = rawDataBuffers[bufIndex].pBytes + jsonBufferViews[i]["byteOffset"].ToInt(); //@Incomplete, byte offset could not be provided, in which case we assume 0
+            // Views point straight into their buffer, which may be a read only file mapping, so they must be inside it
+            int64_t bufIndex = jsonBufferViews[i]["buffer"].ToInt();
+            int64_t byteOffset = jsonBufferViews[i]["byteOffset"].ToInt(); // Missing means 0
+            int64_t byteLength = jsonBufferViews[i]["byteLength"].ToInt();
+            int64_t byteStride = jsonBufferViews[i]["byteStride"].ToInt();
+            if (bufIndex < 0 || bufIndex >= (int64_t)rawDataBuffers.size() || byteOffset < 0 || byteLength < 0 || byteStride < 0
+                || (uint64_t)byteOffset + (uint64_t)byteLength > rawDataBuffers[bufIndex].byteLength)
+            {
+                Log::Crit("Buffer view %i of %s is outside of its buffer", i, path.AsRawString());
+                return false;
+            }
 
-            view.length = jsonBufferViews[i]["byteLength"].ToInt();
+            view.pBuffer = rawDataBuffers[bufIndex].pBytes + byteOffset;
+            view.length = (size_t)byteLength;
+            view.byteStride = (size_t)byteStride;
 
             // @Incomplete, target may not be provided
             int target = jsonBufferViews[i]["target"].ToInt();
@@ -178,20 +511,27 @@ namespace An
         }
 
         eastl::vector<Accessor> accessors;
-        JsonValue& jsonAccessors = parsed["accessors"];
+        JsonLazyValue jsonAccessors = parsed["accessors"];
         accessors.reserve(jsonAccessors.Count());
 
         for (int i = 0; i < jsonAccessors.Count(); i++)
         {
             Accessor acc;
-            JsonValue& jsonAcc = jsonAccessors[i];
+            JsonLazyValue jsonAcc = jsonAccessors[i];
+
+            // Accessors without a buffer view are all zeros, which isn't supported
+            int64_t idx = jsonAcc.HasKey("bufferView") ? jsonAcc["bufferView"].ToInt() : -1;
+            if (idx < 0 || idx >= (int64_t)bufferViews.size())
+            {
+                Log::Crit("Accessor %i of %s has no valid bufferView", i, path.AsRawString());
+                return false;
+            }
 
-            int idx = jsonAcc["bufferView"].ToInt();
-            acc.pBuffer = bufferViews[idx].pBuffer + jsonAcc["byteOffset"].ToInt();
-            
-            acc.count = jsonAcc["count"].ToInt();
+            int64_t byteOffset = jsonAcc["byteOffset"].ToInt();
+            int64_t count = jsonAcc["count"].ToInt();
+            acc.normalized = jsonAcc["normalized"].ToBool();
 
-            int compType = jsonAcc["componentType"].ToInt();
+            int compType = (int)jsonAcc["componentType"].ToInt();
             switch (compType)
             {
             case 5120: acc.componentType = Accessor::Byte; break;
@@ -200,10 +540,12 @@ namespace An
             case 5123: acc.componentType = Accessor::UShort; break;
             case 5125: acc.componentType = Accessor::UInt; break;
             case 5126: acc.componentType = Accessor::Float; break;
-            default: break;
+            default:
+                Log::Crit("Accessor %i of %s has unknown componentType %i", i, path.AsRawString(), compType);
+                return false;
             }
 
-            eastl::string type = jsonAcc["type"].ToString();
+            eastl::string_view type = jsonAcc["type"].ToString();
             if (type == "SCALAR") acc.type = Accessor::Scalar;
             else if (type == "VEC2") acc.type = Accessor::Vec2;
             else if (type == "VEC3") acc.type = Accessor::Vec3;
@@ -211,6 +553,24 @@ namespace An
             else if (type == "MAT2") acc.type = Accessor::Mat2;
             else if (type == "MAT3") acc.type = Accessor::Mat3;
             else if (type == "MAT4") acc.type = Accessor::Mat4;
+            else
+            {
+                Log::Crit("Accessor %i of %s has unknown type %.*s", i, path.AsRawString(), (int)type.size(), type.data());
+                return false;
+            }
+
+            // Every element, including the last one's full size, has to be inside the buffer view
+            const BufferView& view = bufferViews[idx];
+            size_t elementSize = ComponentSize(acc.componentType) * ComponentCount(acc.type);
+            acc.stride = view.byteStride != 0 ? view.byteStride : elementSize;
+            if (byteOffset < 0 || count < 0 || count > INT32_MAX
+                || (count > 0 && (uint64_t)byteOffset + acc.stride * (uint64_t)(count - 1) + elementSize > view.length))
+            {
+                Log::Crit("Accessor %i of %s is outside of its buffer view", i, path.AsRawString());
+                return false;
+            }
+            acc.pBuffer = view.pBuffer + byteOffset;
+            acc.count = (int)count;
 
             accessors.push_back(acc);
         }
@@ -219,93 +579,233 @@ namespace An
         ParseNodesRecursively(nullptr, m_nodes, parsed["scenes"][0]["nodes"], parsed["nodes"]);
 
 
+        eastl::vector<Path> imagePaths;
         if (parsed.HasKey("images"))
         {
-            m_images.reserve(parsed["images"].Count());
+            imagePaths.reserve(parsed["images"].Count());
             for (size_t i = 0; i < parsed["images"].Count(); i++)
             {
-                JsonValue& jsonImage = parsed["images"][i];
-                eastl::string type = jsonImage["mimeType"].ToString();
-                Path imagePath = "Game/Assets/" + jsonImage["name"].ToString() + "." + type.substr(6, 4);
-                m_images.emplace_back(imagePath);
+                JsonLazyValue jsonImage = parsed["images"][i];
+                eastl::string_view type = jsonImage["mimeType"].ToString();
+                imagePaths.push_back("Game/Assets/" + eastl::string(jsonImage["name"].ToString()) + "." + eastl::string(type.substr(6, 4)));
             }
         }
 
+        // Material lookups happen for every primitive, so the paths are only compiled once
+        static const JsonQuery baseColorTextureQuery("/pbrMetallicRoughness/baseColorTexture/index");
+        static const JsonQuery baseColorFactorQuery("/pbrMetallicRoughness/baseColorFactor");
+        JsonLazyValue jsonMaterials = parsed["materials"];
+        JsonLazyValue jsonTextures = parsed["textures"];
+
+        // The lazy document parses as it's read, so it's only read from this thread. Everything the jobs below need from
+        // it is found here first, and they do the copying.
+        eastl::vector<PrimitiveSource> primitiveSources;
+        eastl::vector<uint32_t> firstPrimitiveSources;
         m_meshes.reserve(parsed["meshes"].Count());
         for (int i = 0; i < parsed["meshes"].Count(); i++)
         {
-            JsonValue& jsonMesh = parsed["meshes"][i];
+            // Accessors are referred to by index, which has to be checked before it's used like everything else in the file
+            auto findAccessor = [&](JsonLazyValue parent, const char* key, const Accessor*& pOutAccessor)
+            {
+                pOutAccessor = nullptr;
+                if (!parent.HasKey(key))
+                    return true;
+
+                int64_t id = parent[key].ToInt();
+                if (id < 0 || id >= (int64_t)accessors.size())
+                {
+                    Log::Crit("Mesh %i of %s refers to accessor %lli for %s, which doesn't exist", i, path.AsRawString(), (long long)id, key);
+                    return false;
+                }
+                pOutAccessor = &accessors[id];
+                return true;
+            };
+
+            JsonLazyValue jsonMesh = parsed["meshes"][i];
 
             Mesh mesh;
-            mesh.m_name = jsonMesh.HasKey("name") ? jsonMesh["name"].ToString() : "";
+            mesh.m_name = jsonMesh.HasKey("name") ? eastl::string(jsonMesh["name"].ToString()) : "";
+            firstPrimitiveSources.push_back((uint32_t)primitiveSources.size());
 
             for (int j = 0; j < jsonMesh["primitives"].Count(); j++)
             {
-                JsonValue& jsonPrimitive = jsonMesh["primitives"][j];
+                JsonLazyValue jsonPrimitive = jsonMesh["primitives"][j];
                 Primitive prim;
 
                 if (jsonPrimitive.HasKey("mode"))
                 {
                     if (jsonPrimitive["mode"].ToInt() != 4)
-                    {
-                        return; // Unsupported topology type
-                    }
+                        return false; // Unsupported topology type
                 }
 
                 // Get material texture
                 if (jsonPrimitive.HasKey("material"))
                 {
                     int materialId = jsonPrimitive["material"].ToInt();
-                    JsonValue& jsonMaterial = parsed["materials"][materialId];
-                    JsonValue& pbr = jsonMaterial["pbrMetallicRoughness"];
+                    JsonLazyValue jsonMaterial = jsonMaterials[materialId];
 
-                    if (pbr.HasKey("baseColorTexture"))
+                    JsonLazyValue textureId = baseColorTextureQuery.Find(jsonMaterial);
+                    if (!textureId.IsNull())
                     {
-                        int textureId = pbr["baseColorTexture"]["index"].ToInt();
-                        int imageId = parsed["textures"][textureId]["source"].ToInt();
-                        prim.m_baseColorTexture = imageId;
+                        int64_t texture = textureId.ToInt();
+                        int64_t imageId = texture >= 0 && texture < jsonTextures.Count() ? jsonTextures[texture]["source"].ToInt() : -1;
+                        if (imageId < 0 || imageId >= (int64_t)imagePaths.size())
+                        {
+                            Log::Crit("Material %i of %s refers to a texture with no image", materialId, path.AsRawString());
+                            return false;
+                        }
+                        prim.m_baseColorTexture = (uint32_t)imageId;
                     }
-                    if (pbr.HasKey("baseColorFactor"))
+                    JsonLazyValue baseColorFactor = baseColorFactorQuery.Find(jsonMaterial);
+                    if (!baseColorFactor.IsNull())
                     {
-                        prim.m_baseColor.x = (float)pbr["baseColorFactor"][0].ToFloat();
-                        prim.m_baseColor.y = (float)pbr["baseColorFactor"][1].ToFloat();
-                        prim.m_baseColor.z = (float)pbr["baseColorFactor"][2].ToFloat();
-                        prim.m_baseColor.w = (float)pbr["baseColorFactor"][3].ToFloat();
+                        prim.m_baseColor.x = (float)baseColorFactor[0].ToFloat();
+                        prim.m_baseColor.y = (float)baseColorFactor[1].ToFloat();
+                        prim.m_baseColor.z = (float)baseColorFactor[2].ToFloat();
+                        prim.m_baseColor.w = (float)baseColorFactor[3].ToFloat();
                     }
                 }
 
-                int nVerts = accessors[jsonPrimitive["attributes"]["POSITION"].ToInt()].count;
+                PrimitiveSource source;
+                JsonLazyValue jsonAttr = jsonPrimitive["attributes"];
+                if (!findAccessor(jsonAttr, "POSITION", source.pPositions) || !findAccessor(jsonAttr, "NORMAL", source.pNormals)
+                    || !findAccessor(jsonAttr, "TEXCOORD_0", source.pUv0) || !findAccessor(jsonAttr, "COLOR_0", source.pColors)
+                    || !findAccessor(jsonPrimitive, "indices", source.pIndices))
+                    return false;
 
-                JsonValue& jsonAttr = jsonPrimitive["attributes"];
-                Vec3f* vertPositionBuffer = (Vec3f*)accessors[jsonAttr["POSITION"].ToInt()].pBuffer;
-                prim.m_vertices = eastl::vector<Vec3f>(vertPositionBuffer, vertPositionBuffer + nVerts);
-
-                Vec3f* vertNormBuffer = jsonAttr.HasKey("NORMAL") ? (Vec3f*)accessors[jsonAttr["NORMAL"].ToInt()].pBuffer : nullptr;
-                prim.m_normals = eastl::vector<Vec3f>(vertNormBuffer, vertNormBuffer + nVerts);
+                if (source.pPositions == nullptr)
+                {
+                    Log::Crit("Primitive %i of mesh %i in %s has no positions", j, i, path.AsRawString());
+                    return false;
+                }
 
-                Vec2f* vertTexCoordBuffer = jsonAttr.HasKey("TEXCOORD_0") ? (Vec2f*)accessors[jsonAttr["TEXCOORD_0"].ToInt()].pBuffer : nullptr;
-                prim.m_uv0 = eastl::vector<Vec2f>(vertTexCoordBuffer, vertTexCoordBuffer + nVerts);
-                
-                if (jsonAttr.HasKey("COLOR_0"))
+                // Indices are stored as 16 bit, and gltf reserves the largest value of an index type, so that's the most
+                // vertices a primitive can have
+                if (source.pPositions->count > UINT16_MAX)
                 {
-                    Vec4f* vertColBuffer = (Vec4f*)accessors[jsonAttr["COLOR_0"].ToInt()].pBuffer;
-                    prim.m_colors = eastl::vector<Vec4f>(vertColBuffer, vertColBuffer + nVerts);
+                    Log::Crit("Primitive %i of mesh %i in %s has %i vertices, more than 16 bit indices can address", j, i, path.AsRawString(), source.pPositions->count);
+                    return false;
                 }
 
-                int nIndices = accessors[jsonPrimitive["indices"].ToInt()].count;
-                uint16_t* indexBuffer = (uint16_t*)accessors[jsonPrimitive["indices"].ToInt()].pBuffer;
-                prim.m_indices = eastl::vector<uint16_t>(indexBuffer, indexBuffer + nIndices);
+                const Accessor* pIndices = source.pIndices;
+                if (pIndices && (pIndices->type != Accessor::Scalar
+                    || (pIndices->componentType != Accessor::UByte && pIndices->componentType != Accessor::UShort && pIndices->componentType != Accessor::UInt)))
+                {
+                    Log::Crit("Primitive %i of mesh %i in %s has indices that aren't unsigned integers", j, i, path.AsRawString());
+                    return false;
+                }
+                primitiveSources.push_back(source);
 
-                prim.RecalcLocalBounds();
-                prim.CreateBuffers();
                 mesh.m_primitives.push_back(eastl::move(prim));
             }
             m_meshes.push_back(eastl::move(mesh));
         }
-        
-        for (int i = 0; i < rawDataBuffers.size(); i++)
+
+        for (const Node& node : m_nodes)
+        {
+            if (node.m_meshId != UINT32_MAX && node.m_meshId >= m_meshes.size())
+            {
+                Log::Crit("Node %s of %s refers to mesh %u, which doesn't exist", node.m_name.c_str(), path.AsRawString(), node.m_meshId);
+                return false;
+            }
+        }
+
+        // Meshes are optimized as they're imported, so cooked scenes are saved already optimized
+        MeshOptimizeOptions optimizeOptions;
+        optimizeOptions.m_optimizeOverdraw = true;
+        eastl::vector<MeshOptimizeResult> optimizeResults(primitiveSources.size());
+        std::atomic<bool> validIndices{ true };
+
+        // Images are decoded and meshes filled in on worker threads, with images first as they're the longest jobs
+        m_images.resize(imagePaths.size());
+        uint32_t imageCount = (uint32_t)m_images.size();
+        ParallelFor(imageCount + (uint32_t)m_meshes.size(), [&](uint32_t job)
+        {
+            if (job < imageCount)
+            {
+                m_images[job].Decode(imagePaths[job]);
+                return;
+            }
+
+            uint32_t meshIndex = job - imageCount;
+            Mesh& mesh = m_meshes[meshIndex];
+            for (size_t j = 0; j < mesh.m_primitives.size(); j++)
+            {
+                const PrimitiveSource& source = primitiveSources[firstPrimitiveSources[meshIndex] + j];
+                Primitive& prim = mesh.m_primitives[j];
+
+                // Attributes the primitive doesn't have are left empty. Every one that it does has an element per vertex.
+                int nVerts = source.pPositions->count;
+                prim.m_vertices.resize(nVerts);
+                ReadAccessorFloats(*source.pPositions, 3, (float*)prim.m_vertices.data());
+
+                if (source.pNormals && source.pNormals->count == nVerts)
+                {
+                    prim.m_normals.resize(nVerts);
+                    ReadAccessorFloats(*source.pNormals, 3, (float*)prim.m_normals.data());
+                }
+
+                if (source.pUv0 && source.pUv0->count == nVerts)
+                {
+                    prim.m_uv0.resize(nVerts);
+                    ReadAccessorFloats(*source.pUv0, 2, (float*)prim.m_uv0.data());
+                }
+
+                if (source.pColors && source.pColors->count == nVerts)
+                {
+                    prim.m_colors.resize(nVerts, Vec4f(1.0f));
+                    ReadAccessorFloats(*source.pColors, 4, (float*)prim.m_colors.data());
+                }
+
+                if (source.pIndices)
+                {
+                    prim.m_indices.resize(source.pIndices->count);
+                    if (!ReadAccessorIndices(*source.pIndices, (uint32_t)nVerts, prim.m_indices.data()))
+                    {
+                        Log::Crit("Primitive %zu of mesh %u in %s has indices past the end of its vertices", j, meshIndex, path.AsRawString());
+                        validIndices = false;
+                        return;
+                    }
+                }
+                else
+                {
+                    prim.m_indices.resize(nVerts);
+                    for (int k = 0; k < nVerts; k++)
+                        prim.m_indices[k] = (uint16_t)k;
+                }
+
+                optimizeResults[firstPrimitiveSources[meshIndex] + j] = OptimizePrimitive(prim, optimizeOptions);
+                prim.RecalcLocalBounds();
+            }
+        });
+        if (!validIndices)
+            return false;
+
+        MeshOptimizeResult total;
+        for (const MeshOptimizeResult& result : optimizeResults)
+        {
+            total.m_before += result.m_before;
+            total.m_after += result.m_after;
+        }
+        if (total.m_before.m_triangleCount > 0)
         {
-            delete rawDataBuffers[i].pBytes;
+            Log::Info("Optimized %s for a %u vertex cache, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", path.AsRawString(), optimizeOptions.m_cacheSize,
+                total.m_before.Acmr(), total.m_after.Acmr(), total.m_before.Atvr(), total.m_after.Atvr());
         }
+        return true;
+    }
+
+    // ***********************************************************************
+
+    void Scene::CreateGpuResources()
+    {
+        for (Mesh& mesh : m_meshes)
+        {
+            for (Primitive& prim : mesh.m_primitives)
+                prim.CreateBuffers();
+        }
+
+        for (Image& image : m_images)
+            image.CreateGpuTexture();
     }
 }
\ No newline at end of file
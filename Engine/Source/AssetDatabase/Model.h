@@ -5,11 +5,13 @@
 #include "Core/Vec2.h"
 #include "Core/Quat.h"
 #include "Core/AABB.h"
+#include "Core/MappedFile.h"
 #include "Core/Path.h"
 #include "Mesh.h"
 #include "Image.h"
 
 #include <bgfx/bgfx.h>
+#include <EASTL/shared_ptr.h>
 #include <EASTL/vector.h>
 
 namespace An
@@ -35,11 +37,25 @@ namespace An
         Scene() {}
         Scene(Path path);
 
+        // Loading is split in two so the CPU side can run anywhere, including for several scenes at once on different
+        // threads, while GPU resources are made on the thread that owns bgfx. Scene(path) does both.
+        // Import returns false, and logs why, if the file couldn't be loaded. Imported scenes are cooked, and loaded from
+        // the cooked file from then on until the gltf or its buffer files change, see SceneCooker.h.
+        bool Import(Path path);
+        void CreateGpuResources();
+
         Quatf m_cameraRotation;
         Vec3f m_cameraTranslation;
 
         eastl::vector<Image> m_images;
         eastl::vector<Mesh> m_meshes;
         eastl::vector<Node> m_nodes;
+
+        // External .bin files the scene's buffers came from, kept mapped so other scenes using them can share them
+        eastl::vector<eastl::shared_ptr<MappedFile>> m_bufferFiles;
+
+    private:
+        // Reads the gltf in file, giving the paths of the external buffer files it used, in the order of m_bufferFiles
+        bool ImportGltf(const Path& path, const MappedFile& file, eastl::vector<Path>& outBufferPaths);
     };
 }
\ No newline at end of file
@@ -0,0 +1,450 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "SceneCooker.h"
+
+#include "Model.h"
+#include "Core/FileStream.h"
+#include "Core/FileSystem.h"
+#include "Core/Hash.h"
+#include "Core/Log.h"
+#include "Core/MappedFile.h"
+#include "Core/Parallel.h"
+
+#include <string.h>
+
+namespace An
+{
+    namespace
+    {
+        static constexpr char Magic[4] = { 'A', 'S', 'C', 'N' };
+
+        // Enough for any of the attribute arrays to be read with aligned loads
+        static constexpr size_t VertexDataAlignment = 16;
+
+        // Where an array is in the file, for strings the count doesn't include the null terminator
+        struct CookedRange
+        {
+            uint32_t m_offset;
+            uint32_t m_count;
+        };
+
+        struct CookedHeader
+        {
+            char m_magic[4];
+            uint32_t m_version;
+            uint64_t m_sourceHash;
+            uint64_t m_size;
+            CookedRange m_bufferFiles;
+            CookedRange m_nodes;
+            CookedRange m_meshes;
+            CookedRange m_primitives;
+            CookedRange m_images;
+        };
+
+        struct CookedBufferFile
+        {
+            uint64_t m_hash;
+            CookedRange m_path;
+        };
+
+        // Nodes are in the scene's order, which always has parents before their children
+        struct CookedNode
+        {
+            CookedRange m_name;
+            uint32_t m_parent; // UINT32_MAX for root nodes
+            uint32_t m_meshId;
+            float m_translation[3];
+            float m_scale[3];
+            float m_rotation[4];
+        };
+
+        struct CookedMesh
+        {
+            CookedRange m_name;
+            uint32_t m_firstPrimitive;
+            uint32_t m_primitiveCount;
+        };
+
+        struct CookedPrimitive
+        {
+            uint32_t m_topologyType;
+            uint32_t m_baseColorTexture;
+            float m_baseColor[4];
+            float m_boundsMin[3];
+            float m_boundsMax[3];
+            CookedRange m_vertices;
+            CookedRange m_normals;
+            CookedRange m_uv0;
+            CookedRange m_colors;
+            CookedRange m_indices;
+        };
+
+        struct CookedImage
+        {
+            CookedRange m_path;
+        };
+
+        // ***********************************************************************
+
+        struct CookedWriter
+        {
+            template<typename T>
+            CookedRange WriteArray(const T* pData, size_t count, size_t alignment = alignof(T))
+            {
+                m_data.resize((m_data.size() + alignment - 1) & ~(alignment - 1), 0);
+                CookedRange range = { (uint32_t)m_data.size(), (uint32_t)count };
+                m_data.insert(m_data.end(), (const char*)pData, (const char*)(pData + count));
+                return range;
+            }
+
+            template<typename T>
+            CookedRange WriteVertexData(const eastl::vector<T>& data)
+            {
+                return WriteArray(data.data(), data.size(), VertexDataAlignment);
+            }
+
+            CookedRange WriteString(const eastl::string& string)
+            {
+                CookedRange range = WriteArray(string.c_str(), string.size());
+                m_data.push_back('\0');
+                return range;
+            }
+
+            eastl::vector<char> m_data;
+        };
+
+        // ***********************************************************************
+
+        // Everything read from the file is checked before it's used, the file could be from a crash part way
+        // through being written, or just damaged
+        struct CookedReader
+        {
+            template<typename T>
+            bool IsValid(CookedRange range) const
+            {
+                return range.m_offset % alignof(T) == 0 && range.m_offset <= m_size && range.m_count <= (m_size - range.m_offset) / sizeof(T);
+            }
+
+            bool IsValidString(CookedRange range) const
+            {
+                return range.m_offset < m_size && range.m_count < m_size - range.m_offset && m_pData[range.m_offset + range.m_count] == '\0';
+            }
+
+            template<typename T>
+            const T* Array(CookedRange range) const
+            {
+                return (const T*)(m_pData + range.m_offset);
+            }
+
+            template<typename T>
+            void ReadVertexData(CookedRange range, eastl::vector<T>& outData) const
+            {
+                const T* pData = Array<T>(range);
+                outData.assign(pData, pData + range.m_count);
+            }
+
+            eastl::string ReadString(CookedRange range) const
+            {
+                return eastl::string(m_pData + range.m_offset, range.m_count);
+            }
+
+            const char* m_pData;
+            size_t m_size;
+        };
+
+        // ***********************************************************************
+
+        bool IsValidPrimitive(const CookedReader& reader, const CookedHeader& header, const CookedPrimitive& primitive)
+        {
+            if (primitive.m_topologyType > (uint32_t)Primitive::TopologyType::PointList
+                || (primitive.m_baseColorTexture >= header.m_images.m_count && primitive.m_baseColorTexture != UINT32_MAX)
+                || !reader.IsValid<Vec3f>(primitive.m_vertices)
+                || !reader.IsValid<Vec3f>(primitive.m_normals)
+                || !reader.IsValid<Vec2f>(primitive.m_uv0)
+                || !reader.IsValid<Vec4f>(primitive.m_colors)
+                || !reader.IsValid<uint16_t>(primitive.m_indices))
+                return false;
+
+            // Attributes a primitive doesn't have are empty, the rest have one element per vertex
+            uint32_t vertexCount = primitive.m_vertices.m_count;
+            for (CookedRange attribute : { primitive.m_normals, primitive.m_uv0, primitive.m_colors })
+            {
+                if (attribute.m_count != 0 && attribute.m_count != vertexCount)
+                    return false;
+            }
+
+            // The GPU would read past the end of the vertex buffer otherwise
+            const uint16_t* pIndices = reader.Array<uint16_t>(primitive.m_indices);
+            for (uint32_t i = 0; i < primitive.m_indices.m_count; i++)
+            {
+                if (pIndices[i] >= vertexCount)
+                    return false;
+            }
+            return true;
+        }
+
+        // ***********************************************************************
+
+        bool IsValidCookedScene(const CookedReader& reader, const CookedHeader& header)
+        {
+            if (!reader.IsValid<CookedBufferFile>(header.m_bufferFiles) || !reader.IsValid<CookedNode>(header.m_nodes)
+                || !reader.IsValid<CookedMesh>(header.m_meshes) || !reader.IsValid<CookedPrimitive>(header.m_primitives)
+                || !reader.IsValid<CookedImage>(header.m_images))
+                return false;
+
+            const CookedBufferFile* pBufferFiles = reader.Array<CookedBufferFile>(header.m_bufferFiles);
+            for (uint32_t i = 0; i < header.m_bufferFiles.m_count; i++)
+            {
+                if (!reader.IsValidString(pBufferFiles[i].m_path))
+                    return false;
+            }
+
+            const CookedNode* pNodes = reader.Array<CookedNode>(header.m_nodes);
+            for (uint32_t i = 0; i < header.m_nodes.m_count; i++)
+            {
+                const CookedNode& node = pNodes[i];
+                if (!reader.IsValidString(node.m_name) || (node.m_parent >= i && node.m_parent != UINT32_MAX)
+                    || (node.m_meshId >= header.m_meshes.m_count && node.m_meshId != UINT32_MAX))
+                    return false;
+            }
+
+            const CookedMesh* pMeshes = reader.Array<CookedMesh>(header.m_meshes);
+            for (uint32_t i = 0; i < header.m_meshes.m_count; i++)
+            {
+                const CookedMesh& mesh = pMeshes[i];
+                if (!reader.IsValidString(mesh.m_name) || mesh.m_firstPrimitive > header.m_primitives.m_count
+                    || mesh.m_primitiveCount > header.m_primitives.m_count - mesh.m_firstPrimitive)
+                    return false;
+            }
+
+            const CookedPrimitive* pPrimitives = reader.Array<CookedPrimitive>(header.m_primitives);
+            for (uint32_t i = 0; i < header.m_primitives.m_count; i++)
+            {
+                if (!IsValidPrimitive(reader, header, pPrimitives[i]))
+                    return false;
+            }
+
+            const CookedImage* pImages = reader.Array<CookedImage>(header.m_images);
+            for (uint32_t i = 0; i < header.m_images.m_count; i++)
+            {
+                if (!reader.IsValidString(pImages[i].m_path))
+                    return false;
+            }
+            return true;
+        }
+
+        // ***********************************************************************
+
+        // The buffer files are as much a part of the source as the gltf is, so they're checked every time too
+        bool AreBufferFilesUnchanged(const CookedReader& reader, const CookedHeader& header)
+        {
+            const CookedBufferFile* pBufferFiles = reader.Array<CookedBufferFile>(header.m_bufferFiles);
+            for (uint32_t i = 0; i < header.m_bufferFiles.m_count; i++)
+            {
+                Path path = reader.ReadString(pBufferFiles[i].m_path);
+                if (!FileSys::Exists(path))
+                    return false;
+
+                MappedFile file(path);
+                if (!file.IsValid() || HashBytes(file.Data(), file.Size()) != pBufferFiles[i].m_hash)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    // ***********************************************************************
+
+    Path CookedScenePath(const Path& sourcePath)
+    {
+        return Path(sourcePath.AsString() + ".cooked");
+    }
+
+    // ***********************************************************************
+
+    bool CookScene(const Scene& scene, uint64_t sourceHash, const eastl::vector<Path>& bufferPaths, const Path& cookedPath)
+    {
+        CookedWriter writer;
+        CookedHeader header;
+        memcpy(header.m_magic, Magic, sizeof(Magic));
+        header.m_version = SceneCookerVersion;
+        header.m_sourceHash = sourceHash;
+        writer.WriteArray(&header, 1);
+
+        eastl::vector<CookedPrimitive> primitives;
+        eastl::vector<CookedMesh> meshes;
+        for (const Mesh& mesh : scene.m_meshes)
+        {
+            CookedMesh cookedMesh;
+            cookedMesh.m_name = writer.WriteString(mesh.m_name);
+            cookedMesh.m_firstPrimitive = (uint32_t)primitives.size();
+            cookedMesh.m_primitiveCount = (uint32_t)mesh.m_primitives.size();
+            meshes.push_back(cookedMesh);
+
+            for (const Primitive& prim : mesh.m_primitives)
+            {
+                CookedPrimitive cooked;
+                cooked.m_topologyType = (uint32_t)prim.m_topologyType;
+                cooked.m_baseColorTexture = prim.m_baseColorTexture;
+                for (int i = 0; i < 4; i++)
+                    cooked.m_baseColor[i] = prim.m_baseColor[i];
+                for (int i = 0; i < 3; i++)
+                {
+                    cooked.m_boundsMin[i] = prim.m_localBounds.min[i];
+                    cooked.m_boundsMax[i] = prim.m_localBounds.max[i];
+                }
+                cooked.m_vertices = writer.WriteVertexData(prim.m_vertices);
+                cooked.m_normals = writer.WriteVertexData(prim.m_normals);
+                cooked.m_uv0 = writer.WriteVertexData(prim.m_uv0);
+                cooked.m_colors = writer.WriteVertexData(prim.m_colors);
+                cooked.m_indices = writer.WriteVertexData(prim.m_indices);
+                primitives.push_back(cooked);
+            }
+        }
+
+        eastl::vector<CookedNode> nodes;
+        for (const Node& node : scene.m_nodes)
+        {
+            CookedNode cooked;
+            cooked.m_name = writer.WriteString(node.m_name);
+            cooked.m_parent = node.m_pParent ? uint32_t(node.m_pParent - scene.m_nodes.data()) : UINT32_MAX;
+            cooked.m_meshId = node.m_meshId;
+            for (int i = 0; i < 3; i++)
+            {
+                cooked.m_translation[i] = node.m_translation[i];
+                cooked.m_scale[i] = node.m_scale[i];
+            }
+            cooked.m_rotation[0] = node.m_rotation.x;
+            cooked.m_rotation[1] = node.m_rotation.y;
+            cooked.m_rotation[2] = node.m_rotation.z;
+            cooked.m_rotation[3] = node.m_rotation.w;
+            nodes.push_back(cooked);
+        }
+
+        eastl::vector<CookedBufferFile> bufferFiles;
+        for (size_t i = 0; i < bufferPaths.size(); i++)
+        {
+            const MappedFile& file = *scene.m_bufferFiles[i];
+            bufferFiles.push_back({ HashBytes(file.Data(), file.Size()), writer.WriteString(bufferPaths[i].AsString()) });
+        }
+
+        eastl::vector<CookedImage> images;
+        for (const Image& image : scene.m_images)
+            images.push_back({ writer.WriteString(image.GetPath().AsString()) });
+
+        header.m_bufferFiles = writer.WriteArray(bufferFiles.data(), bufferFiles.size());
+        header.m_nodes = writer.WriteArray(nodes.data(), nodes.size());
+        header.m_meshes = writer.WriteArray(meshes.data(), meshes.size());
+        header.m_primitives = writer.WriteArray(primitives.data(), primitives.size());
+        header.m_images = writer.WriteArray(images.data(), images.size());
+        header.m_size = writer.m_data.size();
+        if (header.m_size > UINT32_MAX)
+        {
+            Log::Warn("%s is too big to be cooked, it will be imported every time", cookedPath.AsRawString());
+            return false;
+        }
+        memcpy(writer.m_data.data(), &header, sizeof(header));
+
+        FileStream file(cookedPath.AsString(), FileWrite | FileBinary);
+        if (!file.IsValid())
+        {
+            Log::Warn("Couldn't open %s to save the cooked scene", cookedPath.AsRawString());
+            return false;
+        }
+        file.Write(writer.m_data.data(), writer.m_data.size());
+        file.Close();
+        return true;
+    }
+
+    // ***********************************************************************
+
+    bool LoadCookedScene(const Path& cookedPath, uint64_t sourceHash, Scene& outScene)
+    {
+        if (!FileSys::Exists(cookedPath))
+            return false;
+
+        MappedFile file(cookedPath);
+        if (!file.IsValid())
+            return false;
+
+        if (file.Size() < sizeof(CookedHeader) || memcmp(file.Data(), Magic, sizeof(Magic)) != 0)
+        {
+            Log::Warn("%s is not a cooked scene, it will be remade", cookedPath.AsRawString());
+            return false;
+        }
+
+        CookedReader reader{ file.Data(), file.Size() };
+        const CookedHeader& header = *(const CookedHeader*)file.Data();
+        if (header.m_version != SceneCookerVersion || header.m_sourceHash != sourceHash)
+            return false;
+
+        if (header.m_size != file.Size() || !IsValidCookedScene(reader, header))
+        {
+            Log::Warn("%s is damaged, it will be remade", cookedPath.AsRawString());
+            return false;
+        }
+
+        if (!AreBufferFilesUnchanged(reader, header))
+            return false;
+
+        const CookedNode* pNodes = reader.Array<CookedNode>(header.m_nodes);
+        outScene.m_nodes.resize(header.m_nodes.m_count);
+        for (uint32_t i = 0; i < header.m_nodes.m_count; i++)
+        {
+            const CookedNode& cooked = pNodes[i];
+            Node& node = outScene.m_nodes[i];
+            node.m_name = reader.ReadString(cooked.m_name);
+            node.m_meshId = cooked.m_meshId;
+            node.m_translation = Vec3f(cooked.m_translation[0], cooked.m_translation[1], cooked.m_translation[2]);
+            node.m_scale = Vec3f(cooked.m_scale[0], cooked.m_scale[1], cooked.m_scale[2]);
+            node.m_rotation = Quatf(cooked.m_rotation[0], cooked.m_rotation[1], cooked.m_rotation[2], cooked.m_rotation[3]);
+            if (cooked.m_parent != UINT32_MAX)
+            {
+                node.m_pParent = &outScene.m_nodes[cooked.m_parent];
+                node.m_pParent->m_children.push_back(&node);
+            }
+        }
+
+        const CookedMesh* pMeshes = reader.Array<CookedMesh>(header.m_meshes);
+        outScene.m_meshes.resize(header.m_meshes.m_count);
+        for (uint32_t i = 0; i < header.m_meshes.m_count; i++)
+        {
+            outScene.m_meshes[i].m_name = reader.ReadString(pMeshes[i].m_name);
+            outScene.m_meshes[i].m_primitives.resize(pMeshes[i].m_primitiveCount);
+        }
+
+        const CookedImage* pImages = reader.Array<CookedImage>(header.m_images);
+        outScene.m_images.resize(header.m_images.m_count);
+
+        // Same as importing, images are decoded and meshes filled in on worker threads, with images first as they're the longest jobs
+        const CookedPrimitive* pPrimitives = reader.Array<CookedPrimitive>(header.m_primitives);
+        uint32_t imageCount = header.m_images.m_count;
+        ParallelFor(imageCount + header.m_meshes.m_count, [&](uint32_t job)
+        {
+            if (job < imageCount)
+            {
+                outScene.m_images[job].Decode(reader.ReadString(pImages[job].m_path));
+                return;
+            }
+
+            uint32_t meshIndex = job - imageCount;
+            Mesh& mesh = outScene.m_meshes[meshIndex];
+            for (size_t j = 0; j < mesh.m_primitives.size(); j++)
+            {
+                const CookedPrimitive& cooked = pPrimitives[pMeshes[meshIndex].m_firstPrimitive + j];
+                Primitive& prim = mesh.m_primitives[j];
+                prim.m_topologyType = (Primitive::TopologyType)cooked.m_topologyType;
+                prim.m_baseColorTexture = cooked.m_baseColorTexture;
+                prim.m_baseColor = Vec4f(cooked.m_baseColor[0], cooked.m_baseColor[1], cooked.m_baseColor[2], cooked.m_baseColor[3]);
+                prim.m_localBounds.min = Vec3f(cooked.m_boundsMin[0], cooked.m_boundsMin[1], cooked.m_boundsMin[2]);
+                prim.m_localBounds.max = Vec3f(cooked.m_boundsMax[0], cooked.m_boundsMax[1], cooked.m_boundsMax[2]);
+                reader.ReadVertexData(cooked.m_vertices, prim.m_vertices);
+                reader.ReadVertexData(cooked.m_normals, prim.m_normals);
+                reader.ReadVertexData(cooked.m_uv0, prim.m_uv0);
+                reader.ReadVertexData(cooked.m_colors, prim.m_colors);
+                reader.ReadVertexData(cooked.m_indices, prim.m_indices);
+            }
+        });
+        return true;
+    }
+}
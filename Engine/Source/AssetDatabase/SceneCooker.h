@@ -0,0 +1,44 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Core/Path.h"
+
+#include <EASTL/vector.h>
+#include <stdint.h>
+
+namespace An
+{
+    struct Scene;
+
+    // Cooked scenes are a Scene saved in the engine's own binary layout, next to the gltf as "<file>.cooked", so a gltf
+    // that hasn't changed since it was last loaded doesn't have its json parsed, buffers decoded or attributes
+    // converted again. Loading one is mapping it and copying the vertex data straight out.
+    //
+    // Layout, in native byte order:
+    //   Header         "ASCN" magic, u32 cooker version, u64 source hash, u64 total size, then an offset and count for
+    //                  each of the tables below
+    //   Vertex data    each primitive's attributes as separate arrays, as they're stored in Primitive, so float
+    //                  Vec3f positions and normals, Vec2f uv0s and Vec4f colors, then u16 indices, each 16 byte
+    //                  aligned. The interleaved or quantized GPU vertex buffers are built from these after loading.
+    //   Strings        null terminated
+    //   Tables         buffer files, nodes, meshes, primitives and images, as fixed size records
+    // Strings and arrays are an offset from the start of the file and a count. Images are only referenced by path, they
+    // are decoded from their own files as normal.
+    ///////////////////////
+
+    // Bump this whenever the layout, or what importing a gltf produces, changes, so old cooked files are remade
+    constexpr uint32_t SceneCookerVersion = 3;
+
+    Path CookedScenePath(const Path& sourcePath);
+
+    // Saves scene, which was imported from a file with HashBytes sourceHash, to cookedPath. The scene's external buffer
+    // files are at bufferPaths, in the same order as scene.m_bufferFiles, and are hashed as well so changing one of them
+    // also makes the cooked file out of date. Returns false, with a warning, if the file couldn't be written.
+    bool CookScene(const Scene& scene, uint64_t sourceHash, const eastl::vector<Path>& bufferPaths, const Path& cookedPath);
+
+    // Loads outScene from cookedPath if it was cooked by this version of the cooker, from a source file with sourceHash
+    // and buffer files that haven't changed since. Returns false otherwise, without touching outScene, so the caller
+    // can import the source instead. A missing or out of date file is expected, only damaged ones are logged.
+    bool LoadCookedScene(const Path& cookedPath, uint64_t sourceHash, Scene& outScene);
+}
@@ -10,20 +10,21 @@ namespace An
 {
 	// ***********************************************************************
 
-    Shader::Shader(Path path)
+    Shader::Shader(Path path, eastl::string defines)
     {
+        m_defines = defines;
         const eastl::string extension = path.Extension().AsString();
 
         const bgfx::Memory* pShaderMem = nullptr;
         if (extension == ".fs")
         {   
             m_type = Fragment;
-            pShaderMem = shaderc::compileShader(shaderc::ST_FRAGMENT, path.AsRawString(), "", "Engine/Shaders/varying.def.sc");
+            pShaderMem = shaderc::compileShader(shaderc::ST_FRAGMENT, path.AsRawString(), m_defines.c_str(), "Engine/Shaders/varying.def.sc");
         }
         else if (extension == ".vs")
         {
             m_type = Vertex;
-            pShaderMem = shaderc::compileShader(shaderc::ST_VERTEX, path.AsRawString(), "", "Engine/Shaders/varying.def.sc");
+            pShaderMem = shaderc::compileShader(shaderc::ST_VERTEX, path.AsRawString(), m_defines.c_str(), "Engine/Shaders/varying.def.sc");
         }
 
         if (pShaderMem != nullptr)
@@ -44,10 +45,10 @@ namespace An
         switch (m_type)
         {
         case Fragment:
-            pNewShaderMem = shaderc::compileShader(shaderc::ST_FRAGMENT, path.AsRawString(), "", "Engine/Shaders/varying.def.sc");
+            pNewShaderMem = shaderc::compileShader(shaderc::ST_FRAGMENT, path.AsRawString(), m_defines.c_str(), "Engine/Shaders/varying.def.sc");
             break;
         case Vertex:
-            pNewShaderMem = shaderc::compileShader(shaderc::ST_VERTEX, path.AsRawString(), "", "Engine/Shaders/varying.def.sc");
+            pNewShaderMem = shaderc::compileShader(shaderc::ST_VERTEX, path.AsRawString(), m_defines.c_str(), "Engine/Shaders/varying.def.sc");
             break;
         default:
             break;
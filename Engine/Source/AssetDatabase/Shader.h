@@ -5,6 +5,7 @@
 #include "Core/Path.h"
 
 #include <bgfx/bgfx.h>
+#include <EASTL/string.h>
 
 namespace An
 {
@@ -17,12 +18,15 @@ namespace An
         };
 
         Shader() {}
-        Shader(Path path);
+
+        // defines are ';' separated, like "QUANTIZED_VERTICES=1", for building variants of the same source
+        Shader(Path path, eastl::string defines = "");
         ~Shader();
         
         void Reload(Path path);
 
         Type m_type;
+        eastl::string m_defines;
 
         bgfx::ShaderHandle m_handle;
     };
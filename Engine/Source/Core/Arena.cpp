@@ -0,0 +1,92 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "Arena.h"
+
+#include <EASTL/allocator.h>
+#include <stdlib.h>
+
+namespace An
+{
+    // ***********************************************************************
+
+    Arena::Arena(size_t blockSize)
+    {
+        m_blockSize = blockSize;
+    }
+
+    // ***********************************************************************
+
+    Arena::~Arena()
+    {
+        Reset();
+    }
+
+    // ***********************************************************************
+
+    void* Arena::Allocate(size_t size, size_t alignment)
+    {
+        char* pResult = (char*)(((uintptr_t)m_pCurrent + (alignment - 1)) & ~(uintptr_t)(alignment - 1));
+        if (m_pCurrent == nullptr || pResult + size > m_pEnd)
+        {
+            // Oversized allocations get a block of their own
+            size_t blockSize = size + alignment > m_blockSize ? size + alignment : m_blockSize;
+            Block* pBlock = (Block*)malloc(sizeof(Block) + blockSize);
+            pBlock->m_pNext = m_pBlocks;
+            pBlock->m_size = blockSize;
+            m_pBlocks = pBlock;
+            m_bytesReserved += blockSize;
+
+            m_pCurrent = (char*)(pBlock + 1);
+            m_pEnd = m_pCurrent + blockSize;
+            pResult = (char*)(((uintptr_t)m_pCurrent + (alignment - 1)) & ~(uintptr_t)(alignment - 1));
+        }
+        m_pCurrent = pResult + size;
+        m_bytesUsed += size;
+        return pResult;
+    }
+
+    // ***********************************************************************
+
+    void Arena::Reset()
+    {
+        Block* pBlock = m_pBlocks;
+        while (pBlock)
+        {
+            Block* pNext = pBlock->m_pNext;
+            free(pBlock);
+            pBlock = pNext;
+        }
+        m_pBlocks = nullptr;
+        m_pCurrent = nullptr;
+        m_pEnd = nullptr;
+        m_bytesUsed = 0;
+        m_bytesReserved = 0;
+    }
+
+    // ***********************************************************************
+
+    void* ArenaAllocator::allocate(size_t n, int flags)
+    {
+        if (m_pArena)
+            return m_pArena->Allocate(n);
+        return eastl::GetDefaultAllocator()->allocate(n, flags);
+    }
+
+    // ***********************************************************************
+
+    void* ArenaAllocator::allocate(size_t n, size_t alignment, size_t offset, int flags)
+    {
+        if (m_pArena)
+            return m_pArena->Allocate(n, alignment);
+        return eastl::GetDefaultAllocator()->allocate(n, alignment, offset, flags);
+    }
+
+    // ***********************************************************************
+
+    void ArenaAllocator::deallocate(void* p, size_t n)
+    {
+        // Arena memory is released all at once by the arena itself
+        if (m_pArena == nullptr)
+            eastl::GetDefaultAllocator()->deallocate(p, n);
+    }
+}
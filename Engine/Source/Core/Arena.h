@@ -0,0 +1,69 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+namespace An
+{
+    // Bump allocator that hands out memory from large blocks. Individual allocations are never freed,
+    // everything goes away at once when the arena is reset or destroyed.
+    struct Arena
+    {
+        Arena(size_t blockSize = 64 * 1024);
+        ~Arena();
+
+        Arena(const Arena& copy) = delete;
+        Arena& operator=(const Arena& copy) = delete;
+
+        void* Allocate(size_t size, size_t alignment = 8);
+
+        template<typename T>
+        T* New()
+        {
+            return new (Allocate(sizeof(T), alignof(T))) T();
+        }
+
+        void Reset();
+
+        // Bytes handed out to users, and bytes actually reserved from the heap
+        size_t BytesUsed() const { return m_bytesUsed; }
+        size_t BytesReserved() const { return m_bytesReserved; }
+
+    private:
+        struct Block
+        {
+            Block* m_pNext;
+            size_t m_size;
+        };
+
+        Block* m_pBlocks{ nullptr };
+        char* m_pCurrent{ nullptr };
+        char* m_pEnd{ nullptr };
+        size_t m_blockSize;
+        size_t m_bytesUsed{ 0 };
+        size_t m_bytesReserved{ 0 };
+    };
+
+    // EASTL compatible allocator, takes memory from the given arena, or from the default heap if no arena is given
+    struct ArenaAllocator
+    {
+        ArenaAllocator(const char* pName = nullptr) {}
+        ArenaAllocator(Arena* pArena) : m_pArena(pArena) {}
+        ArenaAllocator(const ArenaAllocator& other, const char* pName) : m_pArena(other.m_pArena) {}
+
+        void* allocate(size_t n, int flags = 0);
+        void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0);
+        void deallocate(void* p, size_t n);
+
+        const char* get_name() const { return "ArenaAllocator"; }
+        void set_name(const char* pName) {}
+
+        Arena* m_pArena{ nullptr };
+    };
+
+    inline bool operator==(const ArenaAllocator& a, const ArenaAllocator& b) { return a.m_pArena == b.m_pArena; }
+    inline bool operator!=(const ArenaAllocator& a, const ArenaAllocator& b) { return a.m_pArena != b.m_pArena; }
+}
@@ -3,10 +3,27 @@
 #pragma once
 
 #include <EASTL/string.h>
+#include <stdint.h>
 
 namespace An
 {
+    // The number of bytes length characters of base64 decode to, ignoring any padding
+    size_t DecodedBase64Length(const char* encoded, size_t length);
+
+    // Decodes straight into pDestination, which needs room for DecodedBase64Length bytes. Uses AVX2 or SSSE3 where
+    // available. Padding is optional, but any other character that isn't base64, including whitespace, is an error.
+    // Returns false, and logs why, if the text is not valid base64, in which case the destination is partly written.
+    bool DecodeBase64Into(const char* encoded, size_t length, void* pDestination);
+
+    // Inputs shorter than this are always decoded on one thread, as handing out chunks would cost more than it saves
+    constexpr size_t ParallelBase64Threshold = 1024 * 1024;
+
+    // The same as DecodeBase64Into, but large inputs are split into chunks decoded on worker threads.
+    // maxThreads of 0 uses one thread per hardware thread.
+    bool DecodeBase64IntoParallel(const char* encoded, size_t length, void* pDestination, uint32_t maxThreads = 0);
+
+    // Returns an empty string if encoded_string is not valid base64
     eastl::string DecodeBase64(eastl::string const& encoded_string);
 
     eastl::string EncodeBase64(size_t length, const char* bytes);
-}
\ No newline at end of file
+}
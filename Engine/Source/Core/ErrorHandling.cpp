@@ -4,6 +4,7 @@
 
 #include <SDL_messagebox.h>
 #include <EASTL/string.h>
+#include <stdlib.h>
 
 #include "Log.h"
 
@@ -17,11 +18,17 @@ namespace An
 		switch (ShowAssertDialog(errorMsg, file, line))
 		{
 		case 0:
+#if defined(_MSC_VER)
 			_set_abort_behavior(0, _WRITE_ABORT_MSG);
+#endif
 			abort();
 			break;
 		case 1:
+#if defined(_MSC_VER)
 			__debugbreak();
+#else
+			__builtin_trap();
+#endif
 			break;
 		default:
 			break;
@@ -53,7 +60,7 @@ namespace An
 			buttons,
 			nullptr
 		};
-		int buttonid;
+		int buttonid = 0; // Abort if the dialog can't be shown, i.e. when running headless
 		SDL_ShowMessageBox(&messageboxdata, &buttonid);
 		return buttonid;
 	}
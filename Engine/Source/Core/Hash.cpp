@@ -0,0 +1,114 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "Hash.h"
+
+#include <string.h>
+
+namespace An
+{
+    namespace
+    {
+        constexpr uint64_t Prime1 = 11400714785074694791ull;
+        constexpr uint64_t Prime2 = 14029467366897019727ull;
+        constexpr uint64_t Prime3 = 1609587929392839161ull;
+        constexpr uint64_t Prime4 = 9650029242287828579ull;
+        constexpr uint64_t Prime5 = 2870177450012600261ull;
+
+        // ***********************************************************************
+
+        uint64_t RotateLeft(uint64_t value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // ***********************************************************************
+
+        uint64_t Read64(const uint8_t* pData)
+        {
+            uint64_t value;
+            memcpy(&value, pData, sizeof(value));
+            return value;
+        }
+
+        // ***********************************************************************
+
+        uint32_t Read32(const uint8_t* pData)
+        {
+            uint32_t value;
+            memcpy(&value, pData, sizeof(value));
+            return value;
+        }
+
+        // ***********************************************************************
+
+        uint64_t Round(uint64_t accumulator, uint64_t input)
+        {
+            accumulator += input * Prime2;
+            return RotateLeft(accumulator, 31) * Prime1;
+        }
+
+        // ***********************************************************************
+
+        uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+        {
+            hash ^= Round(0, accumulator);
+            return hash * Prime1 + Prime4;
+        }
+    }
+
+    // ***********************************************************************
+
+    uint64_t HashBytes(const void* pData, size_t size, uint64_t seed)
+    {
+        const uint8_t* pInput = (const uint8_t*)pData;
+        const uint8_t* pEnd = pInput + size;
+
+        // Four independent lanes, so the multiplies for each 32 byte stripe can all be in flight at once
+        uint64_t hash;
+        if (size >= 32)
+        {
+            uint64_t lanes[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+            for (; pEnd - pInput >= 32; pInput += 32)
+            {
+                lanes[0] = Round(lanes[0], Read64(pInput));
+                lanes[1] = Round(lanes[1], Read64(pInput + 8));
+                lanes[2] = Round(lanes[2], Read64(pInput + 16));
+                lanes[3] = Round(lanes[3], Read64(pInput + 24));
+            }
+
+            hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+            for (uint64_t lane : lanes)
+                hash = MergeRound(hash, lane);
+        }
+        else
+        {
+            hash = seed + Prime5;
+        }
+        hash += size;
+
+        for (; pEnd - pInput >= 8; pInput += 8)
+        {
+            hash ^= Round(0, Read64(pInput));
+            hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+        }
+        if (pEnd - pInput >= 4)
+        {
+            hash ^= uint64_t(Read32(pInput)) * Prime1;
+            hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+            pInput += 4;
+        }
+        for (; pInput < pEnd; pInput++)
+        {
+            hash ^= *pInput * Prime5;
+            hash = RotateLeft(hash, 11) * Prime1;
+        }
+
+        // Avalanche, so every input bit affects every output bit
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+}
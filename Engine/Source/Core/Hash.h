@@ -0,0 +1,14 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace An
+{
+    // 64 bit hash of some bytes, for content keys like deciding whether a cached file is out of date. This is XXH64
+    // (Collet, xxHash), which reads 32 bytes per step so hashing a whole file runs at close to memory speed.
+    // Not suitable for anything security related.
+    uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = 0);
+}
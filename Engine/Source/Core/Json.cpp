@@ -5,393 +5,411 @@
 #include "Log.h"
 #include "ErrorHandling.h"
 #include "Scanning.h"
+#include "JsonScanner.h"
+#include "NumberParsing.h"
+#include "Parallel.h"
 
 namespace An
 {
-	// Tokenizer
+	// Parser
 	///////////////////////////
 
-	enum TokenType
+	// ***********************************************************************
+
+	template<typename T>
+	T* NewJsonContainer(Arena* pArena)
 	{
-		// Single characters
-		LeftBracket,
-		RightBracket,
-		LeftBrace,
-		RightBrace,
-		Comma,
-		Colon,
+		if (pArena)
+			return new (pArena->Allocate(sizeof(T), alignof(T))) T(ArenaAllocator(pArena));
+		return new T(ArenaAllocator());
+	}
 
-		// Identifiers and keywords
-		Boolean,
-		Null,
-		Identifier,
-		
-		// Everything else
-		Number,
-		String
-	};
+	// ***********************************************************************
+
+	char* NewJsonString(const char* string, size_t length, Arena* pArena)
+	{
+		char* result = pArena ? (char*)pArena->Allocate(length + 1, 1) : new char[length + 1];
+		memcpy(result, string, length);
+		result[length] = '\0';
+		return result;
+	}
+
+	// ***********************************************************************
 
-	struct Token
+	void FreeJsonString(const char* string, Arena* pArena)
 	{
-		Token(TokenType type)
-		: m_type(type) {}
+		// Arena strings, and those pointing into in situ parsed text, are never freed individually
+		if (pArena == nullptr)
+			delete[] string;
+	}
+
+	// ***********************************************************************
 
-		Token(TokenType type, eastl::string _stringOrIdentifier)
-		: m_type(type), m_stringOrIdentifier(_stringOrIdentifier) {}
+	struct JsonParser
+	{
+		Scan::ScanningState scan;
+		Arena* pArena{ nullptr };
 
-		Token(TokenType type, double _number)
-		: m_type(type), m_number(_number) {}
+		// Strings and keys are decoded in place in the source text and point into it, rather than being copied
+		bool inSitu{ false };
 
-		Token(TokenType type, bool _boolean)
-		: m_type(type), m_boolean(_boolean) {}
+		// Array elements and object members are gathered here while parsing so the final containers can be allocated at exactly the right size
+		eastl::vector<JsonValue> valueStack;
+		eastl::vector<JsonObject::value_type> memberStack;
 
-		TokenType m_type;
-		eastl::string m_stringOrIdentifier;
-		double m_number;
-		bool m_boolean;
+		// Set when large arrays near the root can be parsed in parallel, depth is how many containers the parser is inside
+		const JsonParseOptions* pOptions{ nullptr };
+		uint32_t depth{ 0 };
+
+		// Worker threads leave errors for the serial parse that follows to report, as only it knows the correct line
+		bool reportErrors{ true };
 	};
 
 	// ***********************************************************************
 
-	eastl::string ParseStringSlow(Scan::ScanningState& scan, char bound)
+	void ParseError(JsonParser& parser, const char* message)
+	{
+		// Only report the first error, everything after it is likely noise
+		Scan::ScanningState& scan = parser.scan;
+		if (!scan.encounteredError && parser.reportErrors)
+			Log::Crit("Json parse error on line %i: %s", scan.line, message);
+		scan.encounteredError = true;
+		scan.current = (char*)scan.textEnd;
+	}
+
+	// ***********************************************************************
+
+	eastl::string_view ParseString(JsonParser& parser, char bound)
 	{	
+		Scan::ScanningState& scan = parser.scan;
 		char* start = scan.current;
-		char* pos = start;
-		while (*pos != bound && !Scan::IsAtEnd(scan))
+		bool hasEscapes = false;
+		while (true)
+		{
+			scan.current = (char*)JsonScan::FindQuoteOrBackslash(scan.current, scan.textEnd, bound);
+			if (Scan::IsAtEnd(scan) || *(scan.current) == bound)
+				break;
+
+			// Skip the backslash and whatever it escapes, which may be the bound
+			hasEscapes = true;
+			scan.current = scan.current + 2 < scan.textEnd ? scan.current + 2 : (char*)scan.textEnd;
+		}
+		char* end = scan.current;
+		if (Scan::IsAtEnd(scan))
 		{
-			pos++;
+			ParseError(parser, "Unterminated string");
+			return eastl::string_view(NewJsonString("", 0, parser.pArena), 0);
 		}
-		size_t count = pos - start;
-		char* outputString = new char[count * 2]; // to allow for escape chars 
-		pos = outputString;
+		scan.current++; // Skip the closing quote
+
+		// In situ strings are decoded in place, and terminated on or before their closing quote
+		size_t length = end - start;
+		char* result = start;
+		if (!parser.inSitu)
+			result = parser.pArena ? (char*)parser.pArena->Allocate(length + 1, 1) : new char[length + 1];
+
+		if (hasEscapes)
+			length = JsonScan::DecodeEscapes(scan, start, end, result);
+		else if (result != start)
+			memcpy(result, start, length);
+		result[length] = '\0';
+        return eastl::string_view(result, length);
+	}
+
+	// ***********************************************************************
+
+	JsonValue ParseValue(JsonParser& parser);
+
+	JsonValue ParseObject(JsonParser& parser)
+	{
+		Scan::ScanningState& scan = parser.scan;
+		Scan::Advance(scan); // Advance over opening brace
 
-		char* cursor = scan.current;
+		size_t stackBase = parser.memberStack.size();
+		parser.depth++;
 
-		for (size_t i = 0; i < count; i++)
+		JsonScan::SkipWhitespaceAndComments(scan);
+		while (!Scan::IsAtEnd(scan) && Scan::Peek(scan) != '}')
 		{
-			char c = *(cursor++);
-			
-			// Disallowed characters
-			switch (c)
+			// We expect, 
+			// identifier or string
+			eastl::string_view key;
+			char* identifierEnd = nullptr;
+			char c = Scan::Peek(scan);
+			if (c == '"' || c == '\'')
 			{
-			case '\n':
-				break;
-			case '\r':
-				if (Scan::Peek(scan) == '\n') // CRLF line endings
-					cursor++;
-				break;
-				Log::Crit("Unexpected end of line"); break;
-			default:
-				break;
+				Scan::Advance(scan);
+				key = ParseString(parser, c);
 			}
-
-			if (c == '\\')
+			else if (Scan::IsAlpha(c))
 			{
-				char next = *(cursor++);
-				switch (next)
-				{
-				// Convert basic escape sequences to their actual characters
-				case '\'': *pos++ = '\''; break;
-				case '"': *pos++ = '"'; break;
-				case '\\':*pos++ = '\\'; break;
-				case 'b': *pos++ = '\b'; break;
-				case 'f': *pos++ = '\f'; break;
-				case 'n': *pos++ = '\n'; break;
-				case 'r': *pos++ = '\r'; break;
-				case 't': *pos++ = '\t'; break;
-				case 'v': *pos++ = '\v'; break;
-				case '0': *pos++ = '\0'; break;
-
-				// Unicode stuff, not doing this for now
-				case 'u':
-					Log::Crit("This parser does not yet support unicode escape codes"); break;
-				
-				// Line terminators, allowed but we do not include them in the final string
-				case '\n':
-					break;
-				case '\r':
-					if (Scan::Peek(scan) == '\n') // CRLF line endings
-						cursor++;
-					break;
-				default:
-					*pos++ =  next; // all other escaped characters are kept as is, without the '\' that preceeded it
-				}
+				char* start = scan.current;
+				while (!Scan::IsAtEnd(scan) && Scan::IsAlphaNumeric(Scan::Peek(scan)))
+					Scan::Advance(scan);
+
+				identifierEnd = scan.current;
+				if (parser.inSitu)
+					key = eastl::string_view(start, identifierEnd - start);
+				else
+					key = eastl::string_view(NewJsonString(start, identifierEnd - start, parser.pArena), identifierEnd - start);
 			}
 			else
-				*pos++ = c;
-		}
-		cursor++;
-
-		scan.current = cursor;
+			{
+				ParseError(parser, "Expected identifier or string");
+				break;
+			}
 
-		eastl::string result(outputString, pos);
-        delete outputString;
-        return result;
-	}
+			// colon
+			JsonScan::SkipWhitespaceAndComments(scan);
+			if (Scan::IsAtEnd(scan) || Scan::Advance(scan) != ':')
+			{
+				if (!parser.inSitu)
+					FreeJsonString(key.data(), parser.pArena);
+				ParseError(parser, "Expected colon");
+				break;
+			}
 
-	// ***********************************************************************
+			// In situ identifiers have no closing quote to terminate, but everything up to the colon is consumed now
+			if (parser.inSitu && identifierEnd)
+				*identifierEnd = '\0';
+			
+			// String, Number, Boolean, Null, Object or Array
+			JsonValue value = ParseValue(parser);
+			parser.memberStack.push_back(JsonObject::value_type(key, eastl::move(value)));
 
-	eastl::string ParseString(Scan::ScanningState& scan, char bound)
-	{	
-		char* start = scan.current;
-		while (*(scan.current) != bound && !Scan::IsAtEnd(scan))
-		{
-			if (*(scan.current++) == '\\')
+			// Comma, or right brace
+			JsonScan::SkipWhitespaceAndComments(scan);
+			if (Scan::IsAtEnd(scan) || Scan::Peek(scan) == '}')
+				break;
+			if (Scan::Advance(scan) != ',')
 			{
-				scan.current = start;
-				return ParseStringSlow(scan, bound);
+				ParseError(parser, "Expected comma or Right Curly Brace");
+				break;
 			}
+			JsonScan::SkipWhitespaceAndComments(scan);
 		}
-		eastl::string result(start, scan.current);
-		scan.current++;
-        return result;
-	}
 
-	// ***********************************************************************
-
-	double ParseNumber(Scan::ScanningState& scan)
-	{	
-		scan.current -= 1; // Go back to get the first digit or symbol
-		char* start = scan.current;
+		if (!Scan::IsAtEnd(scan))
+			Scan::Advance(scan); // Advance over closing brace
+		else
+			ParseError(parser, "Expected Right Curly Brace");
 
-		// Hex number
-		if (Scan::Peek(scan) == '0' && (Scan::PeekNext(scan) == 'x' || Scan::PeekNext(scan) == 'X'))
+		JsonValue object = JsonValue::NewObject(parser.pArena);
+		JsonObject& members = *object.m_internalData.m_pObject;
+		members.Reserve(parser.memberStack.size() - stackBase);
+		for (size_t i = stackBase; i < parser.memberStack.size(); i++)
 		{
-			Scan::Advance(scan);
-			Scan::Advance(scan);
-			while (Scan::IsHexDigit(Scan::Peek(scan)))
+			JsonObject::value_type& member = parser.memberStack[i];
+
+			// Later duplicate keys replace earlier ones, but keep the earlier one's position
+			if (JsonValue* pExisting = members.Find(member.first))
 			{
-				Scan::Advance(scan);
+				if (!parser.inSitu)
+					FreeJsonString(member.first.data(), parser.pArena);
+				*pExisting = eastl::move(member.second);
 			}
-		}
-		// Normal number
-		else
-		{
-			char c = Scan::Peek(scan);
-			while(Scan::IsDigit(c) 
-			|| c== '+'
-			|| c == '-'
-			|| c == '.'
-			|| c == 'E'
-			|| c == 'e')
+			else
 			{
-				Scan::Advance(scan);
-				c = Scan::Peek(scan);
+				members.Add(member.first) = eastl::move(member.second);
 			}
 		}
-
-		// TODO: error report. This returns 0.0 if no conversion possible. We can look at the literal string and see
-		// If it's 0.0, ".0", "0." or 0. if not there's been an error in the parsing. I know this is cheeky. I don't care.
-		return strtod(start, &scan.current);
+		parser.memberStack.resize(stackBase);
+		parser.depth--;
+		return object;
 	}
 
 	// ***********************************************************************
 
-	eastl::vector<Token> TokenizeJson(eastl::string jsonText)
+	// Parses array elements onto the value stack, up to the closing bracket or the end of the text
+	void ParseElements(JsonParser& parser)
 	{
-		Scan::ScanningState scan;
-		scan.textStart = jsonText.data();
-		scan.textEnd = jsonText.data() + jsonText.size();
-		scan.current = (char*)scan.textStart;
-		scan.line = 1;
-
-		eastl::vector<Token> tokens;
-
-		while (!Scan::IsAtEnd(scan))
+		Scan::ScanningState& scan = parser.scan;
+		JsonScan::SkipWhitespaceAndComments(scan);
+		while (!Scan::IsAtEnd(scan) && Scan::Peek(scan) != ']')
 		{
-			char c = Scan::Advance(scan);
-			int column = int(scan.current - scan.currentLineStart);
-			char* loc = scan.current - 1;
-			switch (c)
-			{
-			// Single character tokens
-			case '[': 
-				tokens.push_back(Token{LeftBracket}); break;
-			case ']': 
-				tokens.push_back(Token{RightBracket}); break;
-			case '{': 
-				tokens.push_back(Token{LeftBrace}); break;
-			case '}': 
-				tokens.push_back(Token{RightBrace}); break;
-			case ':': 
-				tokens.push_back(Token{Colon}); break;
-			case ',': 
-				tokens.push_back(Token{Comma}); break;
-
-			// Comments!
-			case '/':
-				if (Scan::Match(scan, '/'))
-				{
-					while (Scan::Peek(scan) != '\n')
-						Scan::Advance(scan);
-				}
-				else if (Scan::Match(scan, '*'))
-				{
-					while (!(Scan::Peek(scan) == '*' && Scan::PeekNext(scan) == '/'))
-						Scan::Advance(scan);
-
-					Scan::Advance(scan); // *
-					Scan::Advance(scan); // /
-				}
-				break;
-				
-			// Whitespace
-			case ' ':
-			case '\r':
-			case '\n':
-			case '\t':
-				break;
+			// We expect, 
+			// String, Number, Boolean, Null, Object or Array
+			parser.valueStack.push_back(ParseValue(parser));
 
-			// String literals
-			case '\'':
-			{
-				eastl::string string = ParseString(scan, '\'');
-				tokens.push_back(Token{String, string}); break;
+			// Comma, or right bracket
+			JsonScan::SkipWhitespaceAndComments(scan);
+			if (Scan::IsAtEnd(scan) || Scan::Peek(scan) == ']')
 				break;
-			}
-			case '"':
+			if (Scan::Advance(scan) != ',')
 			{
-				eastl::string string = ParseString(scan, '"');
-				tokens.push_back(Token{String, string}); break;
-				break;		
-			}
-
-			default:
-				// Numbers
-				if (Scan::IsDigit(c) || c == '+' || c == '-' || c == '.')
-				{
-					double num = ParseNumber(scan);
-					tokens.push_back(Token{Number, num});
-					break;
-				}
-				
-				// Identifiers and keywords
-				if (Scan::IsAlpha(c))
-				{
-					while (Scan::IsAlphaNumeric(Scan::Peek(scan)))
-						Scan::Advance(scan);
-					
-					eastl::string identifier = eastl::string(loc, scan.current);
-
-					// Check for keywords
-					if (identifier == "true")
-						tokens.push_back(Token{Boolean, true});
-					else if (identifier == "false")
-						tokens.push_back(Token{Boolean, false});
-					else if (identifier == "null")
-						tokens.push_back(Token{Null});
-					else
-						tokens.push_back(Token{Identifier, identifier});
-				}
+				ParseError(parser, "Expected comma or right bracket");
 				break;
 			}
-
+			JsonScan::SkipWhitespaceAndComments(scan);
 		}
-		return tokens;
 	}
 
-
-
-
 	// ***********************************************************************
 
-	eastl::map<eastl::string, JsonValue> ParseObject(eastl::vector<Token>& tokens, int& currentToken);
-	eastl::vector<JsonValue> ParseArray(eastl::vector<Token>& tokens, int& currentToken);
-
-	JsonValue ParseValue(eastl::vector<Token>& tokens, int& currentToken)
+	// Splits the array at the cursor into chunks which are parsed on worker threads, then gathered into outArray.
+	// Returns false, having not moved the cursor, if the array is too small to split or a chunk fails to parse.
+	bool ParseArrayParallel(JsonParser& parser, JsonValue& outArray)
 	{
-		Token& token = tokens[currentToken];
-
-		switch (token.m_type)
+		Scan::ScanningState& scan = parser.scan;
+		size_t chunkSize = parser.pOptions->m_parallelChunkSize;
+		if ((size_t)(scan.textEnd - scan.current) < chunkSize * 2)
+			return false;
+
+		eastl::vector<const char*> chunkStarts;
+		chunkStarts.push_back(scan.current + 1);
+		const char* arrayEnd = JsonScan::SplitArray(scan.current, scan.textEnd, chunkSize, chunkStarts);
+		if (arrayEnd == nullptr || chunkStarts.size() < 2)
+			return false;
+		chunkStarts.push_back(arrayEnd);
+
+		uint32_t chunkCount = uint32_t(chunkStarts.size() - 1);
+		eastl::vector<JsonParser> workers(chunkCount);
+		ParallelFor(chunkCount, [&](uint32_t chunk)
 		{
-		case LeftBrace:
-			return JsonValue(ParseObject(tokens, currentToken)); break;
-		case LeftBracket:
-			return JsonValue(ParseArray(tokens, currentToken)); break;
-		case String:
-			currentToken++;
-			return JsonValue(token.m_stringOrIdentifier); break;
-		case Number:
+			JsonParser& worker = workers[chunk];
+			worker.scan.textStart = scan.textStart;
+			worker.scan.textEnd = chunkStarts[chunk + 1];
+			worker.scan.current = (char*)chunkStarts[chunk];
+			worker.scan.currentLineStart = worker.scan.current;
+			worker.scan.line = 0;
+			worker.pArena = parser.pArena;
+			worker.inSitu = parser.inSitu;
+			worker.reportErrors = false;
+			ParseElements(worker);
+		}, parser.pOptions->m_maxThreads);
+
+		size_t elementCount = 0;
+		for (JsonParser& worker : workers)
 		{
-			currentToken++;
-			double n = token.m_number;
-			double intPart;
-			if (modf(n, &intPart) == 0.0)
-				return JsonValue((long)intPart);
-			else
-				return JsonValue(n);
-			break;
+			if (worker.scan.encounteredError)
+				return false;
+			elementCount += worker.valueStack.size();
 		}
-		case Boolean:
-			currentToken++;
-			return JsonValue(token.m_boolean); break;
-		case Null:
-			currentToken++;
-		default:
-			return JsonValue(); break;
+
+		outArray = JsonValue::NewArray(parser.pArena);
+		JsonArray& elements = *outArray.m_internalData.m_pArray;
+		elements.reserve(elementCount);
+		for (JsonParser& worker : workers)
+		{
+			for (JsonValue& element : worker.valueStack)
+				elements.push_back(eastl::move(element));
+
+			// Workers count lines from zero, so they can just be added on
+			if (worker.scan.line > 0)
+			{
+				scan.line += worker.scan.line;
+				scan.currentLineStart = worker.scan.currentLineStart;
+			}
 		}
-		return JsonValue();
+		scan.current = (char*)arrayEnd + 1;
+		return true;
 	}
 
 	// ***********************************************************************
 
-	eastl::map<eastl::string, JsonValue> ParseObject(eastl::vector<Token>& tokens, int& currentToken)
+	JsonValue ParseArray(JsonParser& parser)
 	{
-		currentToken++; // Advance over opening brace
-
-		eastl::map<eastl::string, JsonValue> map;
-		while (currentToken < tokens.size() && tokens[currentToken].m_type != RightBrace)
+		Scan::ScanningState& scan = parser.scan;
+		if (parser.pOptions && parser.depth < 2)
 		{
-			// We expect, 
-			// identifier or string
-			if (tokens[currentToken].m_type != Identifier && tokens[currentToken].m_type != String)
-				Log::Crit("Expected identifier or string");
+			JsonValue array;
+			if (ParseArrayParallel(parser, array))
+				return array;
+		}
+		Scan::Advance(scan); // Advance over opening bracket
 
-			eastl::string key = tokens[currentToken].m_stringOrIdentifier;
-			currentToken += 1;
+		size_t stackBase = parser.valueStack.size();
+		parser.depth++;
 
-			// colon
-			if (tokens[currentToken].m_type != Colon)
-				Log::Crit("Expected colon");
-			currentToken += 1;
-			
-			// String, Number, Boolean, Null
-			// If left bracket or brace encountered, skip until closing
-			map[key] = ParseValue(tokens, currentToken);
+		ParseElements(parser);
 
-			// Comma, or right brace
-			if (tokens[currentToken].m_type == RightBrace)
-				break;
-			if (tokens[currentToken].m_type != Comma)
-				Log::Crit("Expected comma or Right Curly Brace");
-			currentToken += 1;
-		}
-		currentToken++; // Advance over closing brace
-		return eastl::move(map);
+		if (!Scan::IsAtEnd(scan))
+			Scan::Advance(scan); // Advance over closing bracket
+		else
+			ParseError(parser, "Expected right bracket");
+
+		JsonValue array = JsonValue::NewArray(parser.pArena);
+		JsonArray& elements = *array.m_internalData.m_pArray;
+		elements.reserve(parser.valueStack.size() - stackBase);
+		for (size_t i = stackBase; i < parser.valueStack.size(); i++)
+			elements.push_back(eastl::move(parser.valueStack[i]));
+		parser.valueStack.resize(stackBase);
+		parser.depth--;
+		return array;
 	}
 
 	// ***********************************************************************
 
-	eastl::vector<JsonValue> ParseArray(eastl::vector<Token>& tokens, int& currentToken)
+	JsonValue ParseValue(JsonParser& parser)
 	{
-		currentToken++; // Advance over opening bracket
+		Scan::ScanningState& scan = parser.scan;
+		JsonScan::SkipWhitespaceAndComments(scan);
+		if (Scan::IsAtEnd(scan))
+		{
+			ParseError(parser, "Expected a value");
+			return JsonValue();
+		}
 
-		eastl::vector<JsonValue> array;
-		while (currentToken < tokens.size() && tokens[currentToken].m_type != RightBracket)
+		char c = Scan::Peek(scan);
+		switch (c)
 		{
-			// We expect, 
-			// String, Number, Boolean, Null
-			array.push_back(ParseValue(tokens, currentToken));
+		case '{':
+			return ParseObject(parser);
+		case '[':
+			return ParseArray(parser);
+		case '"':
+		case '\'':
+		{
+			Scan::Advance(scan);
+			eastl::string_view view = ParseString(parser, c);
+			JsonValue string(parser.pArena);
+			string.m_internalData.m_pString = view.data();
+			string.m_stringLength = (uint32_t)view.size();
+			string.m_type = JsonValue::String;
+			return string;
+		}
+		default:
+			break;
+		}
 
-			// Comma, or right brace
-			if (tokens[currentToken].m_type == RightBracket)
-				break;
-			if (tokens[currentToken].m_type != Comma)
-				Log::Crit("Expected comma or right bracket");
-			currentToken += 1;
+		// Numbers
+		if (Scan::IsDigit(c) || c == '+' || c == '-' || c == '.')
+		{
+			ParsedNumber parsed;
+			const char* numberEnd = ParseNumber(scan.current, scan.textEnd, parsed);
+			if (numberEnd == nullptr)
+			{
+				ParseError(parser, "Invalid number");
+				return JsonValue();
+			}
+			scan.current = (char*)numberEnd;
+
+			JsonValue number = parsed.m_isInteger ? JsonValue(parsed.m_integer) : JsonValue(parsed.m_floating);
+			number.m_pArena = parser.pArena;
+			return number;
 		}
-		currentToken++; // Advance over closing bracket
-		return eastl::move(array);
+		
+		// Keywords
+		if (Scan::IsAlpha(c))
+		{
+			char* start = scan.current;
+			while (!Scan::IsAtEnd(scan) && Scan::IsAlphaNumeric(Scan::Peek(scan)))
+				Scan::Advance(scan);
+			
+			size_t length = scan.current - start;
+			JsonValue keyword;
+			if (length == 4 && memcmp(start, "true", 4) == 0)
+				keyword = JsonValue(true);
+			else if (length == 5 && memcmp(start, "false", 5) == 0)
+				keyword = JsonValue(false);
+			else if (length != 4 || memcmp(start, "null", 4) != 0)
+				ParseError(parser, "Unexpected identifier");
+			keyword.m_pArena = parser.pArena;
+			return keyword;
+		}
+
+		ParseError(parser, "Unexpected character");
+		return JsonValue();
 	}
 
 
@@ -404,40 +422,70 @@ namespace An
 
 	JsonValue::~JsonValue()
 	{
-		if (m_type == Type::Array)
-			delete m_internalData.m_pArray;	
-		else if (m_type == Type::Object)
-			delete m_internalData.m_pObject;
-		else if (m_type == Type::String)
-		{
-			delete m_internalData.m_pString;
-		}
-		m_type = Type::Null;
+		Free();
 	}
 
 	// ***********************************************************************
 
-	JsonValue::JsonValue()
+	void JsonValue::Free()
 	{
+		// Arena owned memory is released by the arena all at once
+		if (m_pArena == nullptr)
+		{
+			if (m_type == Type::Array)
+			{
+				delete m_internalData.m_pArray;
+			}
+			else if (m_type == Type::Object)
+			{
+				for (const JsonObject::value_type& member : *m_internalData.m_pObject)
+					FreeJsonString(member.first.data(), nullptr);
+				delete m_internalData.m_pObject;
+			}
+			else if (m_type == Type::String)
+			{
+				FreeJsonString(m_internalData.m_pString, nullptr);
+			}
+		}
 		m_type = Type::Null;
 		m_internalData.m_pArray = nullptr;
+		m_stringLength = 0;
 	}
 
 	// ***********************************************************************
 
-	JsonValue::JsonValue(const JsonValue& copy)
+	void JsonValue::CopyFrom(const JsonValue& copy)
 	{
-		// Copy data from the other value
+		// Deep copies into this value's arena (or the heap), expects this value to be empty
 		switch (copy.m_type)
 		{
 		case Type::Array:
-			m_internalData.m_pArray = new eastl::vector<JsonValue>(*copy.m_internalData.m_pArray);
+		{
+			JsonArray* pArray = NewJsonContainer<JsonArray>(m_pArena);
+			pArray->reserve(copy.m_internalData.m_pArray->size());
+			for (const JsonValue& element : *copy.m_internalData.m_pArray)
+			{
+				pArray->push_back(JsonValue(m_pArena));
+				pArray->back().CopyFrom(element);
+			}
+			m_internalData.m_pArray = pArray;
 			break;
+		}
 		case Type::Object:
-			m_internalData.m_pObject = new eastl::map<eastl::string, JsonValue>(*copy.m_internalData.m_pObject);
+		{
+			JsonObject* pObject = NewJsonContainer<JsonObject>(m_pArena);
+			pObject->Reserve(copy.m_internalData.m_pObject->size());
+			for (const JsonObject::value_type& member : *copy.m_internalData.m_pObject)
+			{
+				eastl::string_view key(NewJsonString(member.first.data(), member.first.size(), m_pArena), member.first.size());
+				pObject->Add(key).CopyFrom(member.second);
+			}
+			m_internalData.m_pObject = pObject;
 			break;
+		}
 		case Type::String:
-			m_internalData.m_pString = new eastl::string(*(copy.m_internalData.m_pString));
+			m_internalData.m_pString = NewJsonString(copy.m_internalData.m_pString, copy.m_stringLength, m_pArena);
+			m_stringLength = copy.m_stringLength;
 			break;
 		default:
 			m_internalData = copy.m_internalData;
@@ -448,75 +496,110 @@ namespace An
 
 	// ***********************************************************************
 
-	JsonValue::JsonValue(JsonValue&& copy)
+	JsonValue::JsonValue()
+	{
+		m_type = Type::Null;
+		m_internalData.m_pArray = nullptr;
+	}
+
+	// ***********************************************************************
+
+	JsonValue::JsonValue(Arena* pArena)
+	{
+		m_type = Type::Null;
+		m_internalData.m_pArray = nullptr;
+		m_pArena = pArena;
+	}
+
+	// ***********************************************************************
+
+	JsonValue::JsonValue(const JsonValue& copy)
+	{
+		// Copies always go to the heap, so they can outlive the document they were copied from
+		m_type = Type::Null;
+		m_pArena = nullptr;
+		CopyFrom(copy);
+	}
+
+	// ***********************************************************************
+
+	JsonValue::JsonValue(JsonValue&& copy) noexcept
 	{
 		m_internalData = copy.m_internalData;
+		m_stringLength = copy.m_stringLength;
 		copy.m_internalData.m_pArray = nullptr;
 
 		m_type = copy.m_type;
-		copy.m_type = Type::Null;	
+		copy.m_type = Type::Null;
+
+		m_pArena = copy.m_pArena;
 	}
 
 	// ***********************************************************************
 
 	JsonValue& JsonValue::operator=(const JsonValue& copy)
 	{
-		// Clear out internal stuff
-		if (m_type == Type::Array)
-			delete m_internalData.m_pArray;	
-		else if (m_type == Type::Object)
-			delete m_internalData.m_pObject;
-		else if (m_type == Type::String)
-			delete m_internalData.m_pString;
-
-		// Copy data from the other value
-		switch (copy.m_type)
-		{
-		case Type::Array:
-			m_internalData.m_pArray = new eastl::vector<JsonValue>(copy.m_internalData.m_pArray->begin(), copy.m_internalData.m_pArray->end());
-			break;
-		case Type::Object:
-			m_internalData.m_pObject = new eastl::map<eastl::string, JsonValue>(copy.m_internalData.m_pObject->begin(), copy.m_internalData.m_pObject->end());
-			break;
-		case Type::String:
-			m_internalData.m_pString = new eastl::string(*(copy.m_internalData.m_pString));
-		default:
-			m_internalData = copy.m_internalData;
-			break;
-		}
-		m_type = copy.m_type;
-
+		if (this == &copy)
+			return *this;
+
+		// Copy before freeing, the value being copied might be a child of this one
+		JsonValue temp(m_pArena);
+		temp.CopyFrom(copy);
+
+		Free();
+		m_internalData = temp.m_internalData;
+		m_stringLength = temp.m_stringLength;
+		m_type = temp.m_type;
+		temp.m_type = Type::Null;
 		return *this;
 	}
 
 	// ***********************************************************************
 
-	JsonValue& JsonValue::operator=(JsonValue&& copy)
+	JsonValue& JsonValue::operator=(JsonValue&& copy) noexcept
 	{
-		m_internalData = copy.m_internalData;
-		copy.m_internalData.m_pArray = nullptr;
+		if (this == &copy)
+			return *this;
 
-		m_type = copy.m_type;
-		copy.m_type = Type::Null;	
+		// Values can only take ownership of memory from the same arena, anything else is copied in
+		if (m_pArena != copy.m_pArena)
+			return operator=((const JsonValue&)copy);
+
+		Data data = copy.m_internalData;
+		Type type = copy.m_type;
+		uint32_t stringLength = copy.m_stringLength;
+		copy.m_internalData.m_pArray = nullptr;
+		copy.m_type = Type::Null;
 
+		Free();
+		m_internalData = data;
+		m_stringLength = stringLength;
+		m_type = type;
 		return *this;
 	}
 
 	// ***********************************************************************
 
-	JsonValue::JsonValue(eastl::vector<JsonValue>& array)
+	JsonValue::JsonValue(const eastl::vector<JsonValue>& array)
 	{
-		m_internalData.m_pArray = nullptr;
-		m_internalData.m_pArray = new eastl::vector<JsonValue>(array.begin(), array.end());
+		m_internalData.m_pArray = NewJsonContainer<JsonArray>(nullptr);
+		m_internalData.m_pArray->reserve(array.size());
+		for (const JsonValue& element : array)
+			m_internalData.m_pArray->push_back(element);
 		m_type = Type::Array;
 	}
 
 	// ***********************************************************************
 
-	JsonValue::JsonValue(eastl::map<eastl::string, JsonValue>& object)
+	JsonValue::JsonValue(const eastl::map<eastl::string, JsonValue>& object)
 	{
-		m_internalData.m_pArray = nullptr;
-		m_internalData.m_pObject = new eastl::map<eastl::string, JsonValue>(object.begin(), object.end());
+		m_internalData.m_pObject = NewJsonContainer<JsonObject>(nullptr);
+		m_internalData.m_pObject->Reserve(object.size());
+		for (const eastl::pair<const eastl::string, JsonValue>& member : object)
+		{
+			eastl::string_view key(NewJsonString(member.first.data(), member.first.size(), nullptr), member.first.size());
+			m_internalData.m_pObject->Add(key).CopyFrom(member.second);
+		}
 		m_type = Type::Object;
 	}
 
@@ -524,8 +607,8 @@ namespace An
 
 	JsonValue::JsonValue(eastl::string string)
 	{
-		m_internalData.m_pArray = nullptr;
-		m_internalData.m_pString = new eastl::string(string);
+		m_internalData.m_pString = NewJsonString(string.data(), string.size(), nullptr);
+		m_stringLength = (uint32_t)string.size();
 		m_type = Type::String;
 	}
 
@@ -533,8 +616,8 @@ namespace An
 
 	JsonValue::JsonValue(const char* string)
 	{
-		m_internalData.m_pArray = nullptr;
-		m_internalData.m_pString = new eastl::string(string);
+		m_stringLength = (uint32_t)strlen(string);
+		m_internalData.m_pString = NewJsonString(string, m_stringLength, nullptr);
 		m_type = Type::String;
 	}
 
@@ -549,7 +632,7 @@ namespace An
 
 	// ***********************************************************************
 
-	JsonValue::JsonValue(long number)
+	JsonValue::JsonValue(int64_t number)
 	{
 		m_internalData.m_pArray = nullptr;
 		m_internalData.m_integerNumber = number;
@@ -567,11 +650,11 @@ namespace An
 
 	// ***********************************************************************
 
-	eastl::string JsonValue::ToString() const
+	eastl::string_view JsonValue::ToString() const
 	{
 		if (m_type == Type::String)
-			return *(m_internalData.m_pString);
-		return eastl::string();
+			return eastl::string_view(m_internalData.m_pString, m_stringLength);
+		return eastl::string_view();
 	}
 
 	// ***********************************************************************
@@ -587,10 +670,12 @@ namespace An
 
 	// ***********************************************************************
 
-	long JsonValue::ToInt() const
+	int64_t JsonValue::ToInt() const
 	{
 		if (m_type == Type::Integer)
 			return m_internalData.m_integerNumber;
+		else if (m_type == Type::Floating)
+			return (int64_t)m_internalData.m_floatingNumber;
 		return 0;
 	}
 
@@ -612,9 +697,11 @@ namespace An
 
 	// ***********************************************************************
 
-	bool JsonValue::HasKey(eastl::string identifier) const
+	bool JsonValue::HasKey(eastl::string_view identifier) const
 	{
-		return m_internalData.m_pObject->count(identifier) >= 1;
+		if (m_type != Type::Object)
+			return false;
+		return m_internalData.m_pObject->Find(identifier) != nullptr;
 	}
 
 	// ***********************************************************************
@@ -630,10 +717,16 @@ namespace An
 
 	// ***********************************************************************
 
-	JsonValue& JsonValue::operator[](eastl::string identifier)
+	JsonValue& JsonValue::operator[](eastl::string_view identifier)
 	{
 		ASSERT(m_type == Type::Object, "Attempting to treat this value as an object when it is not.");
-		return m_internalData.m_pObject->operator[](identifier);
+		JsonObject& object = *m_internalData.m_pObject;
+
+		if (JsonValue* pValue = object.Find(identifier))
+			return *pValue;
+
+		eastl::string_view key(NewJsonString(identifier.data(), identifier.size(), m_pArena), identifier.size());
+		return object.Add(key);
 	}
 
 	// ***********************************************************************
@@ -647,10 +740,14 @@ namespace An
 
 	// ***********************************************************************
 
-	const JsonValue& JsonValue::Get(eastl::string identifier) const
+	const JsonValue& JsonValue::Get(eastl::string_view identifier) const
 	{
 		ASSERT(m_type == Type::Object, "Attempting to treat this value as an object when it is not.");
-		return m_internalData.m_pObject->operator[](identifier);
+		static const JsonValue nullValue;
+
+		if (const JsonValue* pValue = m_internalData.m_pObject->Find(identifier))
+			return *pValue;
+		return nullValue;
 	}
 
 	// ***********************************************************************
@@ -664,111 +761,310 @@ namespace An
 
 	// ***********************************************************************
 
-	void JsonValue::Append(JsonValue& value)
+	void JsonValue::Append(const JsonValue& value)
 	{
 		ASSERT(m_type == Type::Array, "Attempting to treat this value as an array when it is not.");
-		m_internalData.m_pArray->push_back(value);
+		JsonValue element(m_pArena);
+		element.CopyFrom(value);
+		m_internalData.m_pArray->push_back(eastl::move(element));
 	}
 
 	// ***********************************************************************
 
-	JsonValue JsonValue::NewObject()
+	void JsonValue::Insert(size_t index, const JsonValue& value)
 	{
-		return JsonValue(eastl::map<eastl::string, JsonValue>());
+		ASSERT(m_type == Type::Array, "Attempting to treat this value as an array when it is not.");
+		ASSERT(index <= m_internalData.m_pArray->size(), "Inserting past the end of this array");
+		JsonValue element(m_pArena);
+		element.CopyFrom(value);
+		m_internalData.m_pArray->insert(m_internalData.m_pArray->begin() + index, eastl::move(element));
 	}
 
 	// ***********************************************************************
 
-	JsonValue JsonValue::NewArray()
+	bool JsonValue::Remove(eastl::string_view identifier)
 	{
-		return JsonValue(eastl::vector<JsonValue>());
+		ASSERT(m_type == Type::Object, "Attempting to treat this value as an object when it is not.");
+		JsonObject& object = *m_internalData.m_pObject;
+		for (size_t i = 0; i < object.m_members.size(); i++)
+		{
+			if (object.m_members[i].first == identifier)
+			{
+				FreeJsonString(object.m_members[i].first.data(), m_pArena);
+				object.Erase(i);
+				return true;
+			}
+		}
+		return false;
 	}
 
 	// ***********************************************************************
 
-	JsonValue ParseJsonFile(eastl::string& file)
+	void JsonValue::Remove(size_t index)
+	{
+		ASSERT(m_type == Type::Array, "Attempting to treat this value as an array when it is not.");
+		ASSERT(m_internalData.m_pArray->size() > index, "Removing an element that does not exist in this array");
+		m_internalData.m_pArray->erase(m_internalData.m_pArray->begin() + index);
+	}
+
+	// ***********************************************************************
+
+	JsonValue JsonValue::NewObject(Arena* pArena)
 	{
-		eastl::vector<Token> tokens = TokenizeJson(file);
+		JsonValue object(pArena);
+		object.m_internalData.m_pObject = NewJsonContainer<JsonObject>(pArena);
+		object.m_type = Type::Object;
+		return object;
+	}
+
+	// ***********************************************************************
 
-		int firstToken = 0;
-		JsonValue json5 = ParseValue(tokens, firstToken);
-		return json5;
+	JsonValue JsonValue::NewArray(Arena* pArena)
+	{
+		JsonValue array(pArena);
+		array.m_internalData.m_pArray = NewJsonContainer<JsonArray>(pArena);
+		array.m_type = Type::Array;
+		return array;
 	}
 
 	// ***********************************************************************
 
-	eastl::string SerializeJsonValue(JsonValue json, eastl::string indentation)
+	JsonValue JsonValue::NewString(const char* string, size_t length, Arena* pArena)
 	{
-		eastl::string result = "";
-		switch (json.m_type)
-		{
-		case JsonValue::Type::Array:
-			result.append("[");
-			if (json.Count() > 0)
-				result.append("\n");
+		JsonValue result(pArena);
+		result.m_internalData.m_pString = NewJsonString(string, length, pArena);
+		result.m_stringLength = (uint32_t)length;
+		result.m_type = Type::String;
+		return result;
+	}
 
-			for (const JsonValue& val : *json.m_internalData.m_pArray)
-			{
-				result.append_sprintf("    %s%s, \n", indentation.c_str(), SerializeJsonValue(val, indentation + "    ").c_str());
-			}
 
-			if (json.Count() > 0)
-				result.append_sprintf("%s", indentation.c_str());
-			result.append("]");
-			break;
-		case JsonValue::Type::Object:
-		{
-			result.append("{");
-			if (json.Count() > 0)
-				result.append("\n");
 
-			for (const eastl::pair<eastl::string, JsonValue>& val : *json.m_internalData.m_pObject)
+
+	// JsonObject implementation
+	///////////////////////////
+
+	// ***********************************************************************
+
+	uint32_t HashJsonKey(eastl::string_view key)
+	{
+		// FNV-1a, keys are short so anything fancier isn't worth it
+		uint32_t hash = 2166136261u;
+		for (char c : key)
+			hash = (hash ^ (uint8_t)c) * 16777619u;
+		return hash;
+	}
+
+	// ***********************************************************************
+
+	JsonObject::JsonObject(ArenaAllocator allocator)
+		: m_members(allocator)
+		, m_index(allocator)
+	{
+	}
+
+	// ***********************************************************************
+
+	JsonValue* JsonObject::Find(eastl::string_view key)
+	{
+		return const_cast<JsonValue*>(static_cast<const JsonObject*>(this)->Find(key));
+	}
+
+	// ***********************************************************************
+
+	const JsonValue* JsonObject::Find(eastl::string_view key) const
+	{
+		// Small objects are searched linearly, so there's no need to hash the key
+		return Find(key, m_index.empty() ? 0 : HashJsonKey(key));
+	}
+
+	// ***********************************************************************
+
+	const JsonValue* JsonObject::Find(eastl::string_view key, uint32_t hash) const
+	{
+		if (m_index.empty())
+		{
+			for (const value_type& member : m_members)
 			{
-				result.append_sprintf("    %s%s: %s, \n", indentation.c_str(), val.first.c_str(), SerializeJsonValue(val.second, indentation + "    ").c_str());
+				if (member.first == key)
+					return &member.second;
 			}
-
-			if (json.Count() > 0)
-				result.append_sprintf("%s", indentation.c_str());
-			result.append("}");
-		}
-		break;
-		case JsonValue::Type::Floating:
-			result.append_sprintf("%.17g", json.ToFloat());
-			break;
-			// TODO: Serialize with exponentials like we do with floats
-		case JsonValue::Type::Integer:
-			result.append_sprintf("%i", json.ToInt());
-			break;
-		case JsonValue::Type::Boolean:
-			result.append_sprintf("%s", json.ToBool() ? "true" : "false");
-			break;
-		case JsonValue::Type::String:
-			result.append_sprintf("\"%s\"", json.ToString().c_str());
-			break;
-		case JsonValue::Type::Null:
-			result.append("null");
-			break;
-		default:
-			result.append("CANT SERIALIZE YET");
-			break;
+			return nullptr;
 		}
 
-		// Kinda hacky thing that makes small jsonValues serialize as collapsed, easier to read files imo
-		if (result.size() < 100)
+		size_t mask = m_index.size() - 1;
+		for (size_t slot = hash & mask; m_index[slot] != 0; slot = (slot + 1) & mask)
 		{
-			size_t index = 0;
-			while (true) {
-				index = result.find("\n", index);
+			const value_type& member = m_members[m_index[slot] - 1];
+			if (member.first == key)
+				return &member.second;
+		}
+		return nullptr;
+	}
 
-				int count = 1;
-				while((index+count) != eastl::string::npos && result[index+count] == ' ')
-					count++;
+	// ***********************************************************************
 
-				if (index == eastl::string::npos) break;
-				result.replace(index, count, "");
-				index += 1;
-			}
+	JsonValue& JsonObject::Add(eastl::string_view key)
+	{
+		// New values are owned by the same arena as the object
+		m_members.push_back(value_type(key, JsonValue(m_members.get_allocator().m_pArena)));
+
+		if (m_members.size() > LinearSearchLimit)
+		{
+			// Keep the index at most half full so probe sequences stay short
+			if (m_members.size() * 2 > m_index.size())
+				RebuildIndex();
+			else
+				IndexMember(m_members.size() - 1);
 		}
+		return m_members.back().second;
+	}
+
+	// ***********************************************************************
+
+	void JsonObject::Reserve(size_t count)
+	{
+		m_members.reserve(count);
+	}
+
+	// ***********************************************************************
+
+	void JsonObject::Erase(size_t memberIndex)
+	{
+		m_members.erase(m_members.begin() + memberIndex);
+
+		// Every member after the erased one has moved, so the positions in the index are all stale
+		if (m_members.size() > LinearSearchLimit)
+			RebuildIndex();
+		else
+			m_index.clear();
+	}
+
+	// ***********************************************************************
+
+	void JsonObject::RebuildIndex()
+	{
+		// Sized from the capacity so objects built with Reserve only ever index once
+		size_t size = 16;
+		while (size < m_members.capacity() * 2)
+			size *= 2;
+
+		m_index.clear();
+		m_index.resize(size, 0);
+		for (size_t i = 0; i < m_members.size(); i++)
+			IndexMember(i);
+	}
+
+	// ***********************************************************************
+
+	void JsonObject::IndexMember(size_t memberIndex)
+	{
+		size_t mask = m_index.size() - 1;
+		size_t slot = HashJsonKey(m_members[memberIndex].first) & mask;
+		while (m_index[slot] != 0)
+			slot = (slot + 1) & mask;
+		m_index[slot] = (uint32_t)memberIndex + 1;
+	}
+
+
+
+
+	// JsonDocument implementation
+	///////////////////////////
+
+	// ***********************************************************************
+
+	JsonDocument::JsonDocument()
+		: m_root(&m_arena)
+	{
+	}
+
+	// ***********************************************************************
+
+	JsonDocument::JsonDocument(const char* text, size_t length)
+		: m_root(&m_arena)
+	{
+		Parse(text, length);
+	}
+
+	// ***********************************************************************
+
+	void JsonDocument::Parse(const char* text, size_t length)
+	{
+		ParseInternal((char*)text, length, false);
+	}
+
+	// ***********************************************************************
+
+	void JsonDocument::ParseInSitu(char* text, size_t length)
+	{
+		ParseInternal(text, length, true);
+	}
+
+	// ***********************************************************************
+
+	void JsonDocument::ParseInternal(char* text, size_t length, bool inSitu)
+	{
+		// Throw away the old tree wholesale, it's all in the arena
+		m_root.m_type = JsonValue::Null;
+		m_arena.Reset();
+
+		JsonParser parser;
+		parser.scan.textStart = text;
+		parser.scan.textEnd = text + length;
+		parser.scan.current = text;
+		parser.scan.currentLineStart = parser.scan.current;
+		parser.scan.line = 1;
+		parser.pArena = &m_arena;
+		parser.inSitu = inSitu;
+
+		m_root = ParseValue(parser);
+	}
+
+	// ***********************************************************************
+
+	JsonValue ParseJsonFile(const char* text, size_t length)
+	{
+		JsonParser parser;
+		parser.scan.textStart = text;
+		parser.scan.textEnd = text + length;
+		parser.scan.current = (char*)parser.scan.textStart;
+		parser.scan.currentLineStart = parser.scan.current;
+		parser.scan.line = 1;
+
+		return ParseValue(parser);
+	}
+
+	// ***********************************************************************
+
+	JsonValue ParseJsonFile(const char* text, size_t length, const JsonParseOptions& options)
+	{
+		JsonParser parser;
+		parser.scan.textStart = text;
+		parser.scan.textEnd = text + length;
+		parser.scan.current = (char*)parser.scan.textStart;
+		parser.scan.currentLineStart = parser.scan.current;
+		parser.scan.line = 1;
+		if (options.m_parallelChunkSize > 0)
+			parser.pOptions = &options;
+
+		return ParseValue(parser);
+	}
+
+	// ***********************************************************************
+
+	JsonValue ParseJsonFile(eastl::string& file)
+	{
+		return ParseJsonFile(file.data(), file.size());
+	}
+
+	// ***********************************************************************
+
+	eastl::string SerializeJsonValue(const JsonValue& json, JsonWriter::Style style)
+	{
+		eastl::string result;
+		JsonWriter writer(result, style);
+		writer.Write(json);
 		return result;
 	}
-}
\ No newline at end of file
+}
@@ -2,12 +2,22 @@
 
 #pragma once
 
+#include "Arena.h"
+#include "JsonWriter.h"
+
 #include <EASTL/vector.h>
 #include <EASTL/map.h>
 #include <EASTL/string.h>
+#include <EASTL/string_view.h>
 
 namespace An
 {
+	struct JsonValue;
+	struct JsonObject;
+
+	// Containers used inside JsonValues, these allocate from the arena of the value that owns them, or the heap
+	typedef eastl::vector<JsonValue, ArenaAllocator> JsonArray;
+
 	struct JsonValue
 	{
 		enum Type
@@ -22,54 +32,157 @@ namespace An
 		};
 
 		JsonValue();
+		JsonValue(Arena* pArena);
 
 		JsonValue(const JsonValue& copy);
-		JsonValue(JsonValue&& copy);
+		JsonValue(JsonValue&& copy) noexcept;
 		JsonValue& operator=(const JsonValue& copy);
-		JsonValue& operator=(JsonValue&& copy);
+		JsonValue& operator=(JsonValue&& copy) noexcept;
 
-		JsonValue(eastl::vector<JsonValue>& array);
-		JsonValue(eastl::map<eastl::string, JsonValue>& object);
+		JsonValue(const eastl::vector<JsonValue>& array);
+		JsonValue(const eastl::map<eastl::string, JsonValue>& object);
 		JsonValue(eastl::string string);
 		JsonValue(const char* string);
 		JsonValue(double number);
-		JsonValue(long number);
+		JsonValue(int64_t number);
 		JsonValue(bool boolean);
 
-		static JsonValue NewObject();
-		static JsonValue NewArray();
+		static JsonValue NewObject(Arena* pArena = nullptr);
+		static JsonValue NewArray(Arena* pArena = nullptr);
+		static JsonValue NewString(const char* string, size_t length, Arena* pArena = nullptr);
 
 		bool IsNull() const;
-		bool HasKey(eastl::string identifier) const;
+		bool HasKey(eastl::string_view identifier) const;
 		int Count() const;
 
-		eastl::string ToString() const;
+		// Views the value's string, which stays valid for as long as the value (and any in situ source text) does
+		eastl::string_view ToString() const;
 		double ToFloat() const;
-		long ToInt() const;
+		int64_t ToInt() const;
 		bool ToBool() const;
 
-		JsonValue& operator[](eastl::string identifier);
+		JsonValue& operator[](eastl::string_view identifier);
 		JsonValue& operator[](size_t index);
 
-		const JsonValue& Get(eastl::string identifier) const;
+		const JsonValue& Get(eastl::string_view identifier) const;
 		const JsonValue& Get(size_t index) const;
 
-		void Append(JsonValue& value);
+		void Append(const JsonValue& value);
+
+		// Copies value into the array before index, which may be the size of the array to append
+		void Insert(size_t index, const JsonValue& value);
+
+		// Removing keeps the order of the other members or elements. Returns false if there's no such member.
+		bool Remove(eastl::string_view identifier);
+		void Remove(size_t index);
 
 		~JsonValue();
 
 		Type m_type;
+		uint32_t m_stringLength{ 0 };
 		union Data
 		{
-			eastl::vector<JsonValue>* m_pArray;
-			eastl::map<eastl::string, JsonValue>* m_pObject;
-			eastl::string* m_pString;
+			JsonArray* m_pArray;
+			JsonObject* m_pObject;
+			const char* m_pString;
 			double m_floatingNumber;
-			long m_integerNumber;
+			int64_t m_integerNumber;
 			bool m_boolean;
 		} m_internalData;
+
+		// Arena that owns this value's containers and strings, nullptr if they live on the heap.
+		// Values owned by an arena are never freed individually, they all go when the arena does.
+		Arena* m_pArena{ nullptr };
+
+	private:
+		void Free();
+		void CopyFrom(const JsonValue& copy);
 	};
 
+	// The members of a json object, kept in the order they were added. Small objects are searched linearly,
+	// larger ones also keep an open addressing hash index of member positions, so lookups never allocate.
+	// Keys are null terminated views, owned by the object on the heap, or pointing into the arena or in situ parsed text.
+	struct JsonObject
+	{
+		typedef eastl::pair<eastl::string_view, JsonValue> value_type;
+		typedef eastl::vector<value_type, ArenaAllocator> MemberList;
+		typedef MemberList::iterator iterator;
+		typedef MemberList::const_iterator const_iterator;
+
+		JsonObject(ArenaAllocator allocator);
+
+		JsonValue* Find(eastl::string_view key);
+		const JsonValue* Find(eastl::string_view key) const;
+
+		// For callers that already have HashJsonKey(key), like JsonQuery, so it isn't hashed again
+		const JsonValue* Find(eastl::string_view key, uint32_t hash) const;
+
+		// Appends a null member, the key must not already be in the object
+		JsonValue& Add(eastl::string_view key);
+		void Reserve(size_t count);
+
+		// Removes a member, its key is left for the caller to free as the object doesn't know who owns it
+		void Erase(size_t memberIndex);
+
+		size_t size() const { return m_members.size(); }
+		iterator begin() { return m_members.begin(); }
+		iterator end() { return m_members.end(); }
+		const_iterator begin() const { return m_members.begin(); }
+		const_iterator end() const { return m_members.end(); }
+
+		// Objects with more members than this get a hash index
+		static constexpr size_t LinearSearchLimit = 8;
+
+		MemberList m_members;
+		eastl::vector<uint32_t, ArenaAllocator> m_index; // Member position + 1 for each slot, 0 for empty slots
+
+	private:
+		void RebuildIndex();
+		void IndexMember(size_t memberIndex);
+	};
+
+	// Owns a parsed tree of JsonValues and the arena all of its nodes, containers and strings are allocated in.
+	// Destroying the document frees the whole tree at once without visiting any of the nodes.
+	// Values copied out of the document are deep copied to the heap, so can outlive it.
+	struct JsonDocument
+	{
+		JsonDocument();
+		JsonDocument(const char* text, size_t length);
+
+		JsonDocument(const JsonDocument& copy) = delete;
+		JsonDocument& operator=(const JsonDocument& copy) = delete;
+
+		void Parse(const char* text, size_t length);
+
+		// Parses without copying strings, they are unescaped in place and point into text, which must outlive the document
+		void ParseInSitu(char* text, size_t length);
+
+		JsonValue& Root() { return m_root; }
+		JsonValue& operator[](eastl::string_view identifier) { return m_root[identifier]; }
+		JsonValue& operator[](size_t index) { return m_root[index]; }
+
+		Arena m_arena;
+		JsonValue m_root;
+
+	private:
+		void ParseInternal(char* text, size_t length, bool inSitu);
+	};
+
+	struct JsonParseOptions
+	{
+		// Arrays in the root, or the root itself, with at least two chunks' worth of text are split up and the chunks
+		// parsed on worker threads. Zero parses everything on the calling thread.
+		size_t m_parallelChunkSize{ 0 };
+
+		// Zero uses one per hardware thread
+		uint32_t m_maxThreads{ 0 };
+	};
+
+	// Hash used to index object members by key
+	uint32_t HashJsonKey(eastl::string_view key);
+
+	JsonValue ParseJsonFile(const char* text, size_t length);
+	JsonValue ParseJsonFile(const char* text, size_t length, const JsonParseOptions& options);
 	JsonValue ParseJsonFile(eastl::string& file);
-	eastl::string SerializeJsonValue(JsonValue json, eastl::string indentation = "");
-}
\ No newline at end of file
+	eastl::string SerializeJsonValue(const JsonValue& json, JsonWriter::Style style = JsonWriter::Style::Pretty);
+}
@@ -0,0 +1,510 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonBinary.h"
+
+#include "ErrorHandling.h"
+#include "Log.h"
+
+#include <EASTL/hash_map.h>
+#include <string.h>
+
+namespace An
+{
+	namespace
+	{
+		enum Tag : uint8_t
+		{
+			TagNull,
+			TagFalse,
+			TagTrue,
+			TagInt8,
+			TagInt16,
+			TagInt32,
+			TagInt64,
+			TagFloat32,
+			TagFloat64,
+			TagString,
+			TagArray,
+			TagObject
+		};
+
+		static constexpr char Magic[3] = { 'A', 'J', 'B' };
+		static constexpr uint8_t FormatVersion = 1;
+		static constexpr size_t HeaderSize = 12;
+
+		// Values that encode to at most this many bytes are shared when they're repeated
+		static constexpr size_t MaxSharedValueSize = 256;
+
+		// Container members are offset tables after the tag and count
+		static constexpr size_t ContainerHeaderSize = 5;
+		static constexpr size_t ObjectMemberSize = 12;
+
+		// Nothing in the data is aligned, so everything is read and written through memcpy
+		template<typename T>
+		inline T ReadAt(const char* pData, uint32_t offset)
+		{
+			T value;
+			memcpy(&value, pData + offset, sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		inline void Append(eastl::string& output, T value)
+		{
+			output.append((const char*)&value, (const char*)&value + sizeof(T));
+		}
+
+		// ***********************************************************************
+
+		struct BinaryWriter
+		{
+			eastl::string m_output;
+			eastl::string m_encoded;
+			eastl::hash_multimap<uint32_t, uint32_t> m_sharedValues; // Hash of the encoded bytes to where they are
+
+			uint32_t WriteValue(const JsonValue& value)
+			{
+				switch (value.m_type)
+				{
+				case JsonValue::Array:
+				{
+					const JsonArray& array = *value.m_internalData.m_pArray;
+					eastl::vector<uint32_t> offsets;
+					offsets.reserve(array.size());
+					for (const JsonValue& element : array)
+						offsets.push_back(WriteValue(element));
+
+					uint32_t offset = (uint32_t)m_output.size();
+					Append<uint8_t>(m_output, TagArray);
+					Append<uint32_t>(m_output, (uint32_t)offsets.size());
+					m_output.append((const char*)offsets.data(), (const char*)(offsets.data() + offsets.size()));
+					return offset;
+				}
+				case JsonValue::Object:
+				{
+					const JsonObject& object = *value.m_internalData.m_pObject;
+					eastl::vector<uint32_t> offsets;
+					offsets.reserve(object.size() * 3);
+					for (const JsonObject::value_type& member : object)
+					{
+						offsets.push_back(HashJsonKey(member.first));
+						offsets.push_back(WriteString(member.first));
+						offsets.push_back(WriteValue(member.second));
+					}
+
+					uint32_t offset = (uint32_t)m_output.size();
+					Append<uint8_t>(m_output, TagObject);
+					Append<uint32_t>(m_output, (uint32_t)object.size());
+					m_output.append((const char*)offsets.data(), (const char*)(offsets.data() + offsets.size()));
+					return offset;
+				}
+				case JsonValue::String:
+					return WriteString(value.ToString());
+				default:
+					break;
+				}
+
+				m_encoded.clear();
+				switch (value.m_type)
+				{
+				case JsonValue::Integer:
+				{
+					// Stored in the smallest size that holds it exactly
+					int64_t integer = value.m_internalData.m_integerNumber;
+					if (integer == (int8_t)integer)
+					{
+						Append<uint8_t>(m_encoded, TagInt8);
+						Append<int8_t>(m_encoded, (int8_t)integer);
+					}
+					else if (integer == (int16_t)integer)
+					{
+						Append<uint8_t>(m_encoded, TagInt16);
+						Append<int16_t>(m_encoded, (int16_t)integer);
+					}
+					else if (integer == (int32_t)integer)
+					{
+						Append<uint8_t>(m_encoded, TagInt32);
+						Append<int32_t>(m_encoded, (int32_t)integer);
+					}
+					else
+					{
+						Append<uint8_t>(m_encoded, TagInt64);
+						Append<int64_t>(m_encoded, integer);
+					}
+					break;
+				}
+				case JsonValue::Floating:
+				{
+					// Only narrowed when that's lossless, which is true of most numbers that came from floats in the first place
+					double floating = value.m_internalData.m_floatingNumber;
+					if ((double)(float)floating == floating)
+					{
+						Append<uint8_t>(m_encoded, TagFloat32);
+						Append<float>(m_encoded, (float)floating);
+					}
+					else
+					{
+						Append<uint8_t>(m_encoded, TagFloat64);
+						Append<double>(m_encoded, floating);
+					}
+					break;
+				}
+				case JsonValue::Boolean:
+					Append<uint8_t>(m_encoded, value.m_internalData.m_boolean ? TagTrue : TagFalse);
+					break;
+				default:
+					Append<uint8_t>(m_encoded, TagNull);
+					break;
+				}
+				return WriteEncoded();
+			}
+
+			uint32_t WriteString(eastl::string_view string)
+			{
+				m_encoded.clear();
+				Append<uint8_t>(m_encoded, TagString);
+				Append<uint32_t>(m_encoded, (uint32_t)string.size());
+				m_encoded.append(string.data(), string.data() + string.size());
+				m_encoded.push_back('\0');
+				return WriteEncoded();
+			}
+
+			uint32_t WriteEncoded()
+			{
+				bool shared = m_encoded.size() <= MaxSharedValueSize;
+				uint32_t hash = 0;
+				if (shared)
+				{
+					hash = HashJsonKey(eastl::string_view(m_encoded.data(), m_encoded.size()));
+					auto range = m_sharedValues.equal_range(hash);
+					for (auto it = range.first; it != range.second; ++it)
+					{
+						if (m_output.size() - it->second >= m_encoded.size() && memcmp(m_output.data() + it->second, m_encoded.data(), m_encoded.size()) == 0)
+							return it->second;
+					}
+				}
+
+				uint32_t offset = (uint32_t)m_output.size();
+				m_output.append(m_encoded);
+				if (shared)
+					m_sharedValues.insert(eastl::make_pair(hash, offset));
+				return offset;
+			}
+		};
+	}
+
+	// ***********************************************************************
+
+	bool IsJsonBinary(const char* pData, size_t size)
+	{
+		return size >= HeaderSize && memcmp(pData, Magic, sizeof(Magic)) == 0;
+	}
+
+	// ***********************************************************************
+
+	eastl::string SerializeJsonBinary(const JsonValue& json)
+	{
+		BinaryWriter writer;
+		writer.m_output.append(Magic, Magic + sizeof(Magic));
+		Append<uint8_t>(writer.m_output, FormatVersion);
+		Append<uint32_t>(writer.m_output, 0); // Size and root offset are filled in at the end
+		Append<uint32_t>(writer.m_output, 0);
+
+		uint32_t rootOffset = writer.WriteValue(json);
+		uint32_t size = (uint32_t)writer.m_output.size();
+		memcpy(writer.m_output.data() + 4, &size, sizeof(size));
+		memcpy(writer.m_output.data() + 8, &rootOffset, sizeof(rootOffset));
+		return eastl::move(writer.m_output);
+	}
+
+
+
+
+	// JsonBinaryDocument
+	///////////////////////////
+
+	// ***********************************************************************
+
+	JsonBinaryDocument::JsonBinaryDocument()
+	{
+	}
+
+	// ***********************************************************************
+
+	bool JsonBinaryDocument::Open(const Path& path)
+	{
+		m_pData = nullptr;
+		if (!m_file.Open(path))
+			return false;
+		return Load(m_file.Data(), m_file.Size());
+	}
+
+	// ***********************************************************************
+
+	bool JsonBinaryDocument::Load(const char* pData, size_t size)
+	{
+		// The contents are trusted, only the header is checked
+		m_pData = nullptr;
+		if (!IsJsonBinary(pData, size))
+		{
+			Log::Crit("Data is not binary json");
+			return false;
+		}
+		if ((uint8_t)pData[3] != FormatVersion)
+		{
+			Log::Crit("Binary json is version %i, expected version %i", (int)(uint8_t)pData[3], (int)FormatVersion);
+			return false;
+		}
+		if (ReadAt<uint32_t>(pData, 4) > size || ReadAt<uint32_t>(pData, 8) >= size)
+		{
+			Log::Crit("Binary json data is truncated");
+			return false;
+		}
+
+		m_pData = pData;
+		m_size = size;
+		return true;
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonBinaryDocument::Root() const
+	{
+		JsonBinaryValue root;
+		if (m_pData)
+		{
+			root.m_pData = m_pData;
+			root.m_offset = ReadAt<uint32_t>(m_pData, 8);
+		}
+		return root;
+	}
+
+
+
+
+	// JsonBinaryValue
+	///////////////////////////
+
+	// ***********************************************************************
+
+	JsonValue::Type JsonBinaryValue::GetType() const
+	{
+		if (m_pData == nullptr)
+			return JsonValue::Null;
+
+		switch ((uint8_t)m_pData[m_offset])
+		{
+		case TagFalse:
+		case TagTrue: return JsonValue::Boolean;
+		case TagInt8:
+		case TagInt16:
+		case TagInt32:
+		case TagInt64: return JsonValue::Integer;
+		case TagFloat32:
+		case TagFloat64: return JsonValue::Floating;
+		case TagString: return JsonValue::String;
+		case TagArray: return JsonValue::Array;
+		case TagObject: return JsonValue::Object;
+		default: return JsonValue::Null;
+		}
+	}
+
+	// ***********************************************************************
+
+	bool JsonBinaryValue::IsNull() const
+	{
+		return GetType() == JsonValue::Null;
+	}
+
+	// ***********************************************************************
+
+	bool JsonBinaryValue::HasKey(eastl::string_view identifier) const
+	{
+		if (GetType() != JsonValue::Object)
+			return false;
+		return (*this)[identifier].m_pData != nullptr;
+	}
+
+	// ***********************************************************************
+
+	int JsonBinaryValue::Count() const
+	{
+		JsonValue::Type type = GetType();
+		ASSERT(type == JsonValue::Array || type == JsonValue::Object, "Attempting to treat this value as an array or object when it is not.");
+		if (type != JsonValue::Array && type != JsonValue::Object)
+			return 0;
+		return (int)ReadAt<uint32_t>(m_pData, m_offset + 1);
+	}
+
+	// ***********************************************************************
+
+	eastl::string_view JsonBinaryValue::ToString() const
+	{
+		if (GetType() != JsonValue::String)
+			return eastl::string_view();
+		return eastl::string_view(m_pData + m_offset + 5, ReadAt<uint32_t>(m_pData, m_offset + 1));
+	}
+
+	// ***********************************************************************
+
+	double JsonBinaryValue::ToFloat() const
+	{
+		if (m_pData == nullptr)
+			return 0.0;
+
+		switch ((uint8_t)m_pData[m_offset])
+		{
+		case TagFloat32: return ReadAt<float>(m_pData, m_offset + 1);
+		case TagFloat64: return ReadAt<double>(m_pData, m_offset + 1);
+		default: return (double)ToInt();
+		}
+	}
+
+	// ***********************************************************************
+
+	int64_t JsonBinaryValue::ToInt() const
+	{
+		if (m_pData == nullptr)
+			return 0;
+
+		switch ((uint8_t)m_pData[m_offset])
+		{
+		case TagInt8: return ReadAt<int8_t>(m_pData, m_offset + 1);
+		case TagInt16: return ReadAt<int16_t>(m_pData, m_offset + 1);
+		case TagInt32: return ReadAt<int32_t>(m_pData, m_offset + 1);
+		case TagInt64: return ReadAt<int64_t>(m_pData, m_offset + 1);
+		case TagFloat32: return (int64_t)ReadAt<float>(m_pData, m_offset + 1);
+		case TagFloat64: return (int64_t)ReadAt<double>(m_pData, m_offset + 1);
+		default: return 0;
+		}
+	}
+
+	// ***********************************************************************
+
+	bool JsonBinaryValue::ToBool() const
+	{
+		return m_pData != nullptr && (uint8_t)m_pData[m_offset] == TagTrue;
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonBinaryValue::operator[](eastl::string_view identifier) const
+	{
+		ASSERT(GetType() == JsonValue::Object, "Attempting to treat this value as an object when it is not.");
+		return Find(identifier, HashJsonKey(identifier));
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonBinaryValue::Find(eastl::string_view identifier, uint32_t hash) const
+	{
+		JsonBinaryValue result;
+		if (GetType() != JsonValue::Object)
+			return result;
+
+		// Keys are only compared when their hashes match
+		uint32_t count = ReadAt<uint32_t>(m_pData, m_offset + 1);
+		uint32_t member = m_offset + ContainerHeaderSize;
+		for (uint32_t i = 0; i < count; i++, member += ObjectMemberSize)
+		{
+			if (ReadAt<uint32_t>(m_pData, member) != hash)
+				continue;
+
+			JsonBinaryValue key;
+			key.m_pData = m_pData;
+			key.m_offset = ReadAt<uint32_t>(m_pData, member + 4);
+			if (key.ToString() == identifier)
+			{
+				result.m_pData = m_pData;
+				result.m_offset = ReadAt<uint32_t>(m_pData, member + 8);
+				return result;
+			}
+		}
+		return result;
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonBinaryValue::operator[](size_t index) const
+	{
+		ASSERT(GetType() == JsonValue::Array, "Attempting to treat this value as an array when it is not.");
+		if (GetType() != JsonValue::Array)
+			return JsonBinaryValue();
+		return ValueAt(index);
+	}
+
+	// ***********************************************************************
+
+	eastl::string_view JsonBinaryValue::KeyAt(size_t index) const
+	{
+		ASSERT(GetType() == JsonValue::Object, "Attempting to treat this value as an object when it is not.");
+		if (GetType() != JsonValue::Object || index >= (size_t)Count())
+			return eastl::string_view();
+
+		JsonBinaryValue key;
+		key.m_pData = m_pData;
+		key.m_offset = ReadAt<uint32_t>(m_pData, m_offset + ContainerHeaderSize + uint32_t(index) * ObjectMemberSize + 4);
+		return key.ToString();
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonBinaryValue::ValueAt(size_t index) const
+	{
+		JsonBinaryValue result;
+		JsonValue::Type type = GetType();
+		if (type != JsonValue::Array && type != JsonValue::Object)
+			return result;
+
+		ASSERT(index < (size_t)Count(), "Accessing an element that does not exist in this container");
+		if (index >= (size_t)Count())
+			return result;
+
+		result.m_pData = m_pData;
+		if (type == JsonValue::Array)
+			result.m_offset = ReadAt<uint32_t>(m_pData, m_offset + ContainerHeaderSize + uint32_t(index) * 4);
+		else
+			result.m_offset = ReadAt<uint32_t>(m_pData, m_offset + ContainerHeaderSize + uint32_t(index) * ObjectMemberSize + 8);
+		return result;
+	}
+
+	// ***********************************************************************
+
+	JsonValue JsonBinaryValue::Materialize() const
+	{
+		switch (GetType())
+		{
+		case JsonValue::Object:
+		{
+			JsonValue object = JsonValue::NewObject();
+			int count = Count();
+			object.m_internalData.m_pObject->Reserve(count);
+			for (int i = 0; i < count; i++)
+				object[KeyAt(i)] = ValueAt(i).Materialize();
+			return object;
+		}
+		case JsonValue::Array:
+		{
+			JsonValue array = JsonValue::NewArray();
+			int count = Count();
+			array.m_internalData.m_pArray->reserve(count);
+			for (int i = 0; i < count; i++)
+				array.m_internalData.m_pArray->push_back(ValueAt(i).Materialize());
+			return array;
+		}
+		case JsonValue::String:
+		{
+			eastl::string_view string = ToString();
+			return JsonValue::NewString(string.data(), string.size());
+		}
+		case JsonValue::Integer:
+			return JsonValue(ToInt());
+		case JsonValue::Floating:
+			return JsonValue(ToFloat());
+		case JsonValue::Boolean:
+			return JsonValue(ToBool());
+		default:
+			return JsonValue();
+		}
+	}
+}
@@ -0,0 +1,91 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Json.h"
+#include "MappedFile.h"
+
+#include <EASTL/string.h>
+#include <EASTL/string_view.h>
+#include <stdint.h>
+
+namespace An
+{
+    // Compact binary encoding of JsonValue trees, for documents that are loaded far more often than they are edited.
+    // Values are read straight out of the encoded bytes, i.e. a MappedFile, without parsing or building any JsonValues.
+    //
+    // Layout, in native byte order with no padding:
+    //   Header     "AJB" magic, u8 format version, u32 total size, u32 offset of the root value
+    //   Values     a tag byte, followed by
+    //              Null, False, True               nothing
+    //              Int8 to Int64, Float32/64       the number
+    //              String                          u32 length, the bytes and a null terminator
+    //              Array                           u32 count, then a u32 offset for each element
+    //              Object                          u32 count, then u32 key hash, u32 key offset, u32 value offset per member
+    // Offsets are from the start of the data. Children are written before their parents, and identical small values
+    // (mostly repeated keys) are only stored once. Members stay in insertion order.
+    ///////////////////////
+
+    // A view of one value in binary encoded json. Cheap to copy by value, valid for as long as the data is.
+    struct JsonBinaryValue
+    {
+        JsonValue::Type GetType() const;
+        bool IsNull() const;
+        bool HasKey(eastl::string_view identifier) const;
+        int Count() const;
+
+        // Strings point into the data, and are null terminated
+        eastl::string_view ToString() const;
+        double ToFloat() const;
+        int64_t ToInt() const;
+        bool ToBool() const;
+
+        // Missing members give a null value
+        JsonBinaryValue operator[](eastl::string_view identifier) const;
+        JsonBinaryValue operator[](size_t index) const;
+
+        // For callers that already have HashJsonKey(identifier), gives a null value if this isn't an object
+        JsonBinaryValue Find(eastl::string_view identifier, uint32_t hash) const;
+
+        // For walking the members of objects in order, ValueAt also works on arrays
+        eastl::string_view KeyAt(size_t index) const;
+        JsonBinaryValue ValueAt(size_t index) const;
+
+        // Decodes this value, and everything inside it, into a regular JsonValue
+        JsonValue Materialize() const;
+
+        const char* m_pData{ nullptr }; // nullptr for null values that aren't in the data
+        uint32_t m_offset{ 0 };
+    };
+
+    // Binary encoded json, either mapped from a file or viewing data that's already in memory
+    struct JsonBinaryDocument
+    {
+        JsonBinaryDocument();
+
+        JsonBinaryDocument(const JsonBinaryDocument& copy) = delete;
+        JsonBinaryDocument& operator=(const JsonBinaryDocument& copy) = delete;
+
+        // Maps the file for as long as the document is alive
+        bool Open(const Path& path);
+
+        // Views data, which must outlive the document
+        bool Load(const char* pData, size_t size);
+
+        bool IsValid() const { return m_pData != nullptr; }
+
+        JsonBinaryValue Root() const;
+        JsonBinaryValue operator[](eastl::string_view identifier) const { return Root()[identifier]; }
+        JsonBinaryValue operator[](size_t index) const { return Root()[index]; }
+
+    private:
+        MappedFile m_file;
+        const char* m_pData{ nullptr };
+        size_t m_size{ 0 };
+    };
+
+    // Checks for the header, so loaders can accept either text or binary json
+    bool IsJsonBinary(const char* pData, size_t size);
+
+    eastl::string SerializeJsonBinary(const JsonValue& json);
+}
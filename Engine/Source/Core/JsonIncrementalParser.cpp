@@ -0,0 +1,159 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonIncrementalParser.h"
+
+namespace An
+{
+	// ***********************************************************************
+
+	JsonIncrementalParser::JsonIncrementalParser()
+		: m_reader(*this)
+	{
+		m_reader.Begin();
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Feed(const char* text, size_t length)
+	{
+		return m_reader.Feed(text, length);
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Finish(JsonValue& outValue)
+	{
+		bool success = m_reader.Finish();
+		outValue = success ? eastl::move(m_root) : JsonValue();
+		Reset();
+		return success;
+	}
+
+	// ***********************************************************************
+
+	void JsonIncrementalParser::Reset()
+	{
+		m_root = JsonValue();
+		m_containers.clear();
+		m_valueStack.clear();
+		m_memberStack.clear();
+		m_keys.clear();
+		m_reader.Begin();
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::AddValue(JsonValue&& value)
+	{
+		if (m_containers.empty())
+			m_root = eastl::move(value);
+		else if (m_containers.back().m_isObject)
+			m_memberStack.push_back({ m_keyOffset, m_keyLength, eastl::move(value) });
+		else
+			m_valueStack.push_back(eastl::move(value));
+		return true;
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::StartObject()
+	{
+		m_containers.push_back({ true, (uint32_t)m_memberStack.size(), (uint32_t)m_keys.size(), m_keyOffset, m_keyLength });
+		return true;
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Key(eastl::string_view key)
+	{
+		m_keyOffset = (uint32_t)m_keys.size();
+		m_keyLength = (uint32_t)key.size();
+		m_keys.append(key.data(), key.size());
+		return true;
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::EndObject()
+	{
+		Container container = m_containers.back();
+		m_containers.pop_back();
+
+		// Inserting by key means later duplicates replace earlier ones, but keep their position, as they do when parsing
+		JsonValue object = JsonValue::NewObject();
+		object.m_internalData.m_pObject->Reserve(m_memberStack.size() - container.m_stackBase);
+		for (size_t i = container.m_stackBase; i < m_memberStack.size(); i++)
+		{
+			Member& member = m_memberStack[i];
+			object[eastl::string_view(m_keys.data() + member.m_keyOffset, member.m_keyLength)] = eastl::move(member.m_value);
+		}
+		m_memberStack.resize(container.m_stackBase);
+		m_keys.resize(container.m_keysBase);
+
+		m_keyOffset = container.m_keyOffset;
+		m_keyLength = container.m_keyLength;
+		return AddValue(eastl::move(object));
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::StartArray()
+	{
+		m_containers.push_back({ false, (uint32_t)m_valueStack.size(), (uint32_t)m_keys.size(), m_keyOffset, m_keyLength });
+		return true;
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::EndArray()
+	{
+		Container container = m_containers.back();
+		m_containers.pop_back();
+
+		JsonValue array = JsonValue::NewArray();
+		JsonArray& elements = *array.m_internalData.m_pArray;
+		elements.reserve(m_valueStack.size() - container.m_stackBase);
+		for (size_t i = container.m_stackBase; i < m_valueStack.size(); i++)
+			elements.push_back(eastl::move(m_valueStack[i]));
+		m_valueStack.resize(container.m_stackBase);
+
+		m_keyOffset = container.m_keyOffset;
+		m_keyLength = container.m_keyLength;
+		return AddValue(eastl::move(array));
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::String(eastl::string_view value)
+	{
+		return AddValue(JsonValue::NewString(value.data(), value.size()));
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Integer(int64_t value)
+	{
+		return AddValue(JsonValue(value));
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Floating(double value)
+	{
+		return AddValue(JsonValue(value));
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Boolean(bool value)
+	{
+		return AddValue(JsonValue(value));
+	}
+
+	// ***********************************************************************
+
+	bool JsonIncrementalParser::Null()
+	{
+		return AddValue(JsonValue());
+	}
+}
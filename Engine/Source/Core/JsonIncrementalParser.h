@@ -0,0 +1,73 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Json.h"
+#include "JsonReader.h"
+
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdint.h>
+
+namespace An
+{
+    // Builds a JsonValue from json text that arrives in pieces, like blocks read from a FileStream or a pipe from the
+    // asset tools, so reading and parsing can overlap. Chunks can be split anywhere, even in the middle of a token, and
+    // the result is the same as ParseJsonFile on the whole text. Only an unfinished token is kept between calls to Feed,
+    // never the whole text.
+    struct JsonIncrementalParser : private JsonHandler
+    {
+        JsonIncrementalParser();
+
+        // Returns false if the text so far is invalid, after which the rest of it is ignored
+        bool Feed(const char* text, size_t length);
+
+        // Call after the last chunk. Returns false, with a null outValue, if the text was invalid or incomplete.
+        // The parser is then ready for the next document.
+        bool Finish(JsonValue& outValue);
+
+    private:
+        bool StartObject() override;
+        bool Key(eastl::string_view key) override;
+        bool EndObject() override;
+        bool StartArray() override;
+        bool EndArray() override;
+
+        bool String(eastl::string_view value) override;
+        bool Integer(int64_t value) override;
+        bool Floating(double value) override;
+        bool Boolean(bool value) override;
+        bool Null() override;
+
+        void Reset();
+        bool AddValue(JsonValue&& value);
+
+        struct Container
+        {
+            bool m_isObject;
+            uint32_t m_stackBase; // Where this container's elements or members start on the value or member stack
+            uint32_t m_keysBase; // Where its keys start in m_keys
+            uint32_t m_keyOffset; // The key of the member this container is the value of, if it is one
+            uint32_t m_keyLength;
+        };
+
+        struct Member
+        {
+            uint32_t m_keyOffset; // Keys are kept in m_keys, as the reader's are only valid for the duration of the call
+            uint32_t m_keyLength;
+            JsonValue m_value;
+        };
+
+        JsonReader m_reader;
+        JsonValue m_root;
+
+        // Like the parser, elements and members are gathered here until their container ends, so it can be allocated
+        // at exactly the right size
+        eastl::vector<Container> m_containers;
+        eastl::vector<JsonValue> m_valueStack;
+        eastl::vector<Member> m_memberStack;
+        eastl::string m_keys;
+        uint32_t m_keyOffset{ 0 }; // The most recent key, for the next value
+        uint32_t m_keyLength{ 0 };
+    };
+}
@@ -0,0 +1,533 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonLazy.h"
+
+#include "ErrorHandling.h"
+#include "JsonScanner.h"
+#include "Log.h"
+#include "NumberParsing.h"
+#include "Scanning.h"
+
+#include <EASTL/algorithm.h>
+#include <string.h>
+
+namespace An
+{
+	namespace
+	{
+		// Returns the character after the string starting at cursor, or nullptr if it's unterminated
+		const char* SkipString(const char* cursor, const char* end, bool& outHasEscapes)
+		{
+			char bound = *(cursor++);
+			outHasEscapes = false;
+			while (true)
+			{
+				cursor = JsonScan::FindQuoteOrBackslash(cursor, end, bound);
+				if (cursor >= end)
+					return nullptr;
+				if (*cursor == bound)
+					return cursor + 1;
+
+				// Skip the backslash and whatever it escapes, which may be the bound
+				outHasEscapes = true;
+				if (cursor + 2 > end)
+					return nullptr;
+				cursor += 2;
+			}
+		}
+
+		// ***********************************************************************
+
+		void InitScan(Scan::ScanningState& scan, const char* start, const char* cursor, const char* end)
+		{
+			scan.textStart = start;
+			scan.textEnd = end;
+			scan.current = (char*)cursor;
+			scan.currentLineStart = scan.current;
+		}
+	}
+
+	// JsonLazyDocument
+	///////////////////////////
+
+	// ***********************************************************************
+
+	JsonLazyDocument::JsonLazyDocument()
+	{
+	}
+
+	// ***********************************************************************
+
+	JsonLazyDocument::JsonLazyDocument(const char* text, size_t length)
+	{
+		Parse(text, length);
+	}
+
+	// ***********************************************************************
+
+	bool JsonLazyDocument::Parse(const char* text, size_t length)
+	{
+		ASSERT(length < UINT32_MAX, "Json text is too large to be lazily parsed");
+		m_pText = text;
+		m_length = length;
+		m_root = JsonLazyValue();
+		m_containers.clear();
+		m_longStrings.clear();
+		m_decodedStrings.clear();
+		m_arena.Reset();
+
+		// Find the extent of every container. Strings are skipped with the vectorized scanner, as they may contain brackets,
+		// and make up most of the text in files with embedded buffers
+		eastl::vector<uint32_t> openContainers;
+		const char* cursor = text;
+		const char* end = text + length;
+		while (true)
+		{
+			cursor = JsonScan::FindStructureCharacter(cursor, end);
+			if (cursor >= end)
+				break;
+
+			switch (*cursor)
+			{
+			case '"':
+			case '\'':
+			{
+				bool hasEscapes;
+				const char* stringEnd = SkipString(cursor, end, hasEscapes);
+				if (stringEnd == nullptr)
+				{
+					Error(cursor, "Unterminated string");
+					return false;
+				}
+				if (stringEnd - cursor >= LongStringLength)
+					m_longStrings.push_back({ uint32_t(cursor - text), uint32_t(stringEnd - text), hasEscapes });
+				cursor = stringEnd;
+				continue;
+			}
+			case '{':
+			case '[':
+			{
+				Container container;
+				container.m_open = uint32_t(cursor - text);
+				openContainers.push_back((uint32_t)m_containers.size());
+				m_containers.push_back(container);
+				break;
+			}
+			case '}':
+			case ']':
+			{
+				char opener = *cursor == '}' ? '{' : '[';
+				if (openContainers.empty() || text[m_containers[openContainers.back()].m_open] != opener)
+				{
+					Error(cursor, *cursor == '}' ? "Unexpected Right Curly Brace" : "Unexpected right bracket");
+					return false;
+				}
+				Container& container = m_containers[openContainers.back()];
+				container.m_close = uint32_t(cursor - text);
+				container.m_next = (uint32_t)m_containers.size();
+				openContainers.pop_back();
+				break;
+			}
+			case '/':
+			{
+				// Comments may contain anything, so they're skipped too
+				Scan::ScanningState scan;
+				InitScan(scan, text, cursor, end);
+				JsonScan::SkipWhitespaceAndComments(scan);
+				if (scan.current != cursor)
+				{
+					cursor = scan.current;
+					continue;
+				}
+				break;
+			}
+			default:
+				break;
+			}
+			cursor++;
+		}
+
+		if (!openContainers.empty())
+		{
+			Error(end, "Unexpected end of json");
+			return false;
+		}
+
+		Scan::ScanningState scan;
+		InitScan(scan, text, text, end);
+		JsonScan::SkipWhitespaceAndComments(scan);
+		if (Scan::IsAtEnd(scan))
+		{
+			Error(end, "Expected a value");
+			return false;
+		}
+
+		m_root.m_pDocument = this;
+		m_root.m_offset = uint32_t(scan.current - text);
+		if (*scan.current == '{' || *scan.current == '[')
+			m_root.m_container = 0;
+		return true;
+	}
+
+	// ***********************************************************************
+
+	JsonLazyDocument::Container& JsonLazyDocument::GetMembers(uint32_t containerIndex)
+	{
+		Container& container = m_containers[containerIndex];
+		if (container.m_memberCount == UINT32_MAX)
+			FindMembers(container, containerIndex);
+		return container;
+	}
+
+	// ***********************************************************************
+
+	void JsonLazyDocument::FindMembers(Container& container, uint32_t containerIndex)
+	{
+		// Walks the container's direct members, jumping over any nested containers using their recorded extents
+		bool isObject = m_pText[container.m_open] == '{';
+		uint32_t nextContainer = containerIndex + 1;
+
+		Scan::ScanningState scan;
+		InitScan(scan, m_pText, m_pText + container.m_open + 1, m_pText + container.m_close);
+
+		m_memberScratch.clear();
+		while (true)
+		{
+			JsonScan::SkipWhitespaceAndComments(scan);
+			if (Scan::IsAtEnd(scan))
+				break;
+
+			Member member;
+			if (isObject)
+			{
+				char c = Scan::Peek(scan);
+				if (c == '"' || c == '\'')
+				{
+					bool hasEscapes;
+					const char* keyEnd = FindStringEnd(scan.current, hasEscapes);
+					member.m_key = DecodeString(scan.current, keyEnd, hasEscapes);
+					scan.current = (char*)keyEnd;
+				}
+				else if (Scan::IsAlpha(c))
+				{
+					char* start = scan.current;
+					while (!Scan::IsAtEnd(scan) && Scan::IsAlphaNumeric(Scan::Peek(scan)))
+						Scan::Advance(scan);
+					member.m_key = eastl::string_view(start, scan.current - start);
+				}
+				else
+				{
+					Error(scan.current, "Expected identifier or string");
+					break;
+				}
+
+				JsonScan::SkipWhitespaceAndComments(scan);
+				if (Scan::IsAtEnd(scan) || Scan::Advance(scan) != ':')
+				{
+					Error(scan.current, "Expected colon");
+					break;
+				}
+				JsonScan::SkipWhitespaceAndComments(scan);
+				if (Scan::IsAtEnd(scan))
+				{
+					Error(scan.current, "Expected a value");
+					break;
+				}
+			}
+
+			member.m_value.m_pDocument = this;
+			member.m_value.m_offset = uint32_t(scan.current - m_pText);
+
+			char c = Scan::Peek(scan);
+			if (c == '{' || c == '[')
+			{
+				member.m_value.m_container = nextContainer;
+				scan.current = (char*)m_pText + m_containers[nextContainer].m_close + 1;
+				nextContainer = m_containers[nextContainer].m_next;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				bool hasEscapes;
+				scan.current = (char*)FindStringEnd(scan.current, hasEscapes);
+			}
+			else
+			{
+				// Scalars are only checked when they're read, here we just need to find where they end
+				char* start = scan.current;
+				while (!Scan::IsAtEnd(scan) && !Scan::IsWhitespace(Scan::Peek(scan)) && Scan::Peek(scan) != ',' && Scan::Peek(scan) != '/')
+					Scan::Advance(scan);
+				if (scan.current == start)
+				{
+					Error(scan.current, "Unexpected character");
+					break;
+				}
+			}
+			m_memberScratch.push_back(member);
+
+			// Trailing commas are allowed
+			JsonScan::SkipWhitespaceAndComments(scan);
+			if (Scan::IsAtEnd(scan))
+				break;
+			if (Scan::Advance(scan) != ',')
+			{
+				Error(scan.current - 1, isObject ? "Expected comma or Right Curly Brace" : "Expected comma or right bracket");
+				break;
+			}
+		}
+
+		container.m_memberCount = (uint32_t)m_memberScratch.size();
+		container.m_pMembers = (Member*)m_arena.Allocate(sizeof(Member) * m_memberScratch.size(), alignof(Member));
+		for (size_t i = 0; i < m_memberScratch.size(); i++)
+			new (&container.m_pMembers[i]) Member(m_memberScratch[i]);
+	}
+
+	// ***********************************************************************
+
+	const char* JsonLazyDocument::FindStringEnd(const char* start, bool& outHasEscapes)
+	{
+		// Long strings were found by Parse, so they don't need scanning again
+		uint32_t offset = uint32_t(start - m_pText);
+		const LongString* pLongString = eastl::lower_bound(m_longStrings.begin(), m_longStrings.end(), offset,
+			[](const LongString& longString, uint32_t offset) { return longString.m_start < offset; });
+		if (pLongString != m_longStrings.end() && pLongString->m_start == offset)
+		{
+			outHasEscapes = pLongString->m_hasEscapes;
+			return m_pText + pLongString->m_end;
+		}
+		return SkipString(start, m_pText + m_length, outHasEscapes);
+	}
+
+	// ***********************************************************************
+
+	eastl::string_view JsonLazyDocument::DecodeString(const char* start, const char* end, bool hasEscapes)
+	{
+		// start is the opening quote, end is just after the closing quote
+		const char* contents = start + 1;
+		size_t length = end - 1 - contents;
+		if (!hasEscapes)
+			return eastl::string_view(contents, length);
+
+		// Values can be read any number of times, but each string is only decoded into the arena once
+		uint32_t offset = uint32_t(start - m_pText);
+		auto found = m_decodedStrings.find(offset);
+		if (found != m_decodedStrings.end())
+			return found->second;
+
+		Scan::ScanningState scan;
+		InitScan(scan, m_pText, contents, end - 1);
+		char* decoded = (char*)m_arena.Allocate(length + 1, 1);
+		length = JsonScan::DecodeEscapes(scan, contents, end - 1, decoded);
+		decoded[length] = '\0';
+
+		eastl::string_view result(decoded, length);
+		m_decodedStrings.insert(eastl::make_pair(offset, result));
+		return result;
+	}
+
+	// ***********************************************************************
+
+	void JsonLazyDocument::Error(const char* location, const char* message)
+	{
+		// Lines aren't tracked while skipping through the text, so they're counted only when there's an error to report
+		int line = 1;
+		for (const char* cursor = m_pText; cursor < location; cursor++)
+			line += *cursor == '\n';
+		Log::Crit("Json parse error on line %i: %s", line, message);
+	}
+
+
+
+
+	// JsonLazyValue
+	///////////////////////////
+
+	// ***********************************************************************
+
+	JsonValue::Type JsonLazyValue::GetType() const
+	{
+		if (m_pDocument == nullptr)
+			return JsonValue::Null;
+
+		const char* pValue = m_pDocument->m_pText + m_offset;
+		switch (*pValue)
+		{
+		case '{': return JsonValue::Object;
+		case '[': return JsonValue::Array;
+		case '"':
+		case '\'': return JsonValue::String;
+		case 't':
+		case 'f': return JsonValue::Boolean;
+		case 'n': return JsonValue::Null;
+		default:
+			break;
+		}
+
+		ParsedNumber number;
+		if (ParseNumber(pValue, m_pDocument->m_pText + m_pDocument->m_length, number) == nullptr)
+			return JsonValue::Null;
+		return number.m_isInteger ? JsonValue::Integer : JsonValue::Floating;
+	}
+
+	// ***********************************************************************
+
+	bool JsonLazyValue::IsNull() const
+	{
+		return GetType() == JsonValue::Null;
+	}
+
+	// ***********************************************************************
+
+	bool JsonLazyValue::HasKey(eastl::string_view identifier) const
+	{
+		if (GetType() != JsonValue::Object)
+			return false;
+		return (*this)[identifier].m_pDocument != nullptr;
+	}
+
+	// ***********************************************************************
+
+	int JsonLazyValue::Count() const
+	{
+		ASSERT(m_container != UINT32_MAX, "Attempting to treat this value as an array or object when it is not.");
+		if (m_container == UINT32_MAX)
+			return 0;
+		return (int)m_pDocument->GetMembers(m_container).m_memberCount;
+	}
+
+	// ***********************************************************************
+
+	eastl::string_view JsonLazyValue::ToString() const
+	{
+		if (GetType() != JsonValue::String)
+			return eastl::string_view();
+
+		// Strings with escapes are decoded into the document's arena the first time they're read
+		const char* pValue = m_pDocument->m_pText + m_offset;
+		bool hasEscapes;
+		const char* end = m_pDocument->FindStringEnd(pValue, hasEscapes);
+		return m_pDocument->DecodeString(pValue, end, hasEscapes);
+	}
+
+	// ***********************************************************************
+
+	double JsonLazyValue::ToFloat() const
+	{
+		if (m_pDocument == nullptr)
+			return 0.0;
+
+		const char* pValue = m_pDocument->m_pText + m_offset;
+		if (!Scan::IsDigit(*pValue) && *pValue != '+' && *pValue != '-' && *pValue != '.')
+			return 0.0;
+
+		ParsedNumber number;
+		if (ParseNumber(pValue, m_pDocument->m_pText + m_pDocument->m_length, number) == nullptr)
+		{
+			m_pDocument->Error(pValue, "Invalid number");
+			return 0.0;
+		}
+		return number.m_isInteger ? (double)number.m_integer : number.m_floating;
+	}
+
+	// ***********************************************************************
+
+	int64_t JsonLazyValue::ToInt() const
+	{
+		if (m_pDocument == nullptr)
+			return 0;
+
+		const char* pValue = m_pDocument->m_pText + m_offset;
+		if (!Scan::IsDigit(*pValue) && *pValue != '+' && *pValue != '-' && *pValue != '.')
+			return 0;
+
+		ParsedNumber number;
+		if (ParseNumber(pValue, m_pDocument->m_pText + m_pDocument->m_length, number) == nullptr)
+		{
+			m_pDocument->Error(pValue, "Invalid number");
+			return 0;
+		}
+		return number.m_isInteger ? number.m_integer : (int64_t)number.m_floating;
+	}
+
+	// ***********************************************************************
+
+	bool JsonLazyValue::ToBool() const
+	{
+		if (m_pDocument == nullptr)
+			return false;
+
+		const char* pValue = m_pDocument->m_pText + m_offset;
+		return m_pDocument->m_length - m_offset >= 4 && memcmp(pValue, "true", 4) == 0;
+	}
+
+	// ***********************************************************************
+
+	JsonLazyValue JsonLazyValue::operator[](eastl::string_view identifier) const
+	{
+		ASSERT(GetType() == JsonValue::Object, "Attempting to treat this value as an object when it is not.");
+		if (GetType() != JsonValue::Object)
+			return JsonLazyValue();
+
+		// Searched from the end so the last of any duplicate keys wins, as it does when parsing into a JsonValue
+		JsonLazyDocument::Container& container = m_pDocument->GetMembers(m_container);
+		for (uint32_t i = container.m_memberCount; i > 0; i--)
+		{
+			if (container.m_pMembers[i - 1].m_key == identifier)
+				return container.m_pMembers[i - 1].m_value;
+		}
+		return JsonLazyValue();
+	}
+
+	// ***********************************************************************
+
+	JsonLazyValue JsonLazyValue::operator[](size_t index) const
+	{
+		ASSERT(GetType() == JsonValue::Array, "Attempting to treat this value as an array when it is not.");
+		if (GetType() != JsonValue::Array)
+			return JsonLazyValue();
+		return ValueAt(index);
+	}
+
+	// ***********************************************************************
+
+	eastl::string_view JsonLazyValue::KeyAt(size_t index) const
+	{
+		ASSERT(GetType() == JsonValue::Object, "Attempting to treat this value as an object when it is not.");
+		if (GetType() != JsonValue::Object)
+			return eastl::string_view();
+
+		JsonLazyDocument::Container& container = m_pDocument->GetMembers(m_container);
+		if (index >= container.m_memberCount)
+			return eastl::string_view();
+		return container.m_pMembers[index].m_key;
+	}
+
+	// ***********************************************************************
+
+	JsonLazyValue JsonLazyValue::ValueAt(size_t index) const
+	{
+		if (m_container == UINT32_MAX)
+			return JsonLazyValue();
+
+		JsonLazyDocument::Container& container = m_pDocument->GetMembers(m_container);
+		ASSERT(index < container.m_memberCount, "Accessing an element that does not exist in this container");
+		if (index >= container.m_memberCount)
+			return JsonLazyValue();
+		return container.m_pMembers[index].m_value;
+	}
+
+	// ***********************************************************************
+
+	JsonValue JsonLazyValue::Materialize() const
+	{
+		if (m_pDocument == nullptr)
+			return JsonValue();
+
+		const char* pValue = m_pDocument->m_pText + m_offset;
+		if (m_container != UINT32_MAX)
+		{
+			const JsonLazyDocument::Container& container = m_pDocument->m_containers[m_container];
+			return ParseJsonFile(pValue, container.m_close - container.m_open + 1);
+		}
+		return ParseJsonFile(pValue, m_pDocument->m_length - m_offset);
+	}
+}
@@ -0,0 +1,116 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Arena.h"
+#include "Json.h"
+
+#include <EASTL/hash_map.h>
+#include <EASTL/string_view.h>
+#include <EASTL/vector.h>
+#include <stdint.h>
+
+namespace An
+{
+    struct JsonLazyDocument;
+
+    // A view of one value in a JsonLazyDocument, nothing is parsed until it's asked for.
+    // Cheap to copy around by value, and valid for as long as the document is.
+    struct JsonLazyValue
+    {
+        JsonValue::Type GetType() const;
+        bool IsNull() const;
+        bool HasKey(eastl::string_view identifier) const;
+        int Count() const;
+
+        // Strings view the document's text where possible, so unlike JsonValue strings they are not null terminated
+        eastl::string_view ToString() const;
+        double ToFloat() const;
+        int64_t ToInt() const;
+        bool ToBool() const;
+
+        // Missing members give a null value. If a key is duplicated the last one is used, like JsonValue does, though
+        // Count, KeyAt and ValueAt still see every member.
+        JsonLazyValue operator[](eastl::string_view identifier) const;
+        JsonLazyValue operator[](size_t index) const;
+
+        // For walking the members of objects in order, ValueAt also works on arrays
+        eastl::string_view KeyAt(size_t index) const;
+        JsonLazyValue ValueAt(size_t index) const;
+
+        // Fully parses this value, and everything inside it, into a regular JsonValue
+        JsonValue Materialize() const;
+
+        JsonLazyDocument* m_pDocument{ nullptr }; // nullptr for null values that aren't in the document
+        uint32_t m_offset{ 0 }; // Where the value starts in the document's text
+        uint32_t m_container{ UINT32_MAX }; // The value's index in the document's container list, if it's an array or object
+    };
+
+    // On demand json parsing, for when only a small part of a large document is going to be read.
+    // Parsing only finds where each array and object starts and ends. The members of a container are found the first
+    // time it's accessed, and scalars are only parsed when read, so subtrees that are never touched cost one skip.
+    // The text is not copied or modified, and must outlive the document.
+    struct JsonLazyDocument
+    {
+        JsonLazyDocument();
+        JsonLazyDocument(const char* text, size_t length);
+
+        JsonLazyDocument(const JsonLazyDocument& copy) = delete;
+        JsonLazyDocument& operator=(const JsonLazyDocument& copy) = delete;
+
+        // Returns false if the structure of the document is invalid, errors inside scalars are reported when they're read
+        bool Parse(const char* text, size_t length);
+
+        JsonLazyValue Root() { return m_root; }
+        JsonLazyValue operator[](eastl::string_view identifier) { return m_root[identifier]; }
+        JsonLazyValue operator[](size_t index) { return m_root[index]; }
+
+    private:
+        friend struct JsonLazyValue;
+
+        struct Member
+        {
+            eastl::string_view m_key; // Empty for array elements
+            JsonLazyValue m_value;
+        };
+
+        struct Container
+        {
+            uint32_t m_open; // Offset of the opening bracket
+            uint32_t m_close; // Offset of the closing bracket
+            uint32_t m_next; // Index of the first container after this one closes, so its contents can be skipped
+            uint32_t m_memberCount{ UINT32_MAX }; // UINT32_MAX until the members are found
+            Member* m_pMembers{ nullptr };
+        };
+
+        Container& GetMembers(uint32_t container);
+        void FindMembers(Container& container, uint32_t containerIndex);
+        const char* FindStringEnd(const char* start, bool& outHasEscapes);
+        eastl::string_view DecodeString(const char* start, const char* end, bool hasEscapes);
+        void Error(const char* location, const char* message);
+
+        const char* m_pText{ nullptr };
+        size_t m_length{ 0 };
+        JsonLazyValue m_root;
+
+        // Every array and object in the document, in the order they open
+        eastl::vector<Container> m_containers;
+
+        // Where strings at least LongStringLength long end, like embedded buffers, so they're only ever scanned once
+        struct LongString
+        {
+            uint32_t m_start;
+            uint32_t m_end;
+            bool m_hasEscapes;
+        };
+        static constexpr ptrdiff_t LongStringLength = 256;
+        eastl::vector<LongString> m_longStrings;
+
+        // Strings with escapes, by the offset of their opening quote, decoded into the arena
+        eastl::hash_map<uint32_t, eastl::string_view> m_decodedStrings;
+
+        // Members and decoded strings
+        Arena m_arena;
+        eastl::vector<Member> m_memberScratch;
+    };
+}
@@ -0,0 +1,453 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonPatch.h"
+
+#include "FileStream.h"
+#include "Log.h"
+
+#include <EASTL/vector.h>
+#include <string.h>
+
+namespace An
+{
+	namespace
+	{
+		// Escapes token as a JSON Pointer reference token and appends it to path
+		void AppendPointerToken(eastl::string& path, eastl::string_view token)
+		{
+			path.push_back('/');
+			for (char c : token)
+			{
+				if (c == '~')
+					path.append("~0");
+				else if (c == '/')
+					path.append("~1");
+				else
+					path.push_back(c);
+			}
+		}
+
+		// ***********************************************************************
+
+		// Splits a JSON Pointer into its unescaped tokens, returns false if it isn't valid
+		bool SplitPointer(eastl::string_view pointer, eastl::vector<eastl::string>& outTokens)
+		{
+			outTokens.clear();
+			if (!pointer.empty() && pointer[0] != '/')
+				return false;
+
+			for (size_t cursor = 0; cursor < pointer.size();)
+			{
+				cursor++; // The '/'
+				eastl::string& token = outTokens.push_back();
+				while (cursor < pointer.size() && pointer[cursor] != '/')
+				{
+					char c = pointer[cursor++];
+					if (c == '~')
+					{
+						char escape = cursor < pointer.size() ? pointer[cursor++] : '\0';
+						if (escape != '0' && escape != '1')
+							return false;
+						c = escape == '0' ? '~' : '/';
+					}
+					token.push_back(c);
+				}
+			}
+			return true;
+		}
+
+		// ***********************************************************************
+
+		// Array indices are decimal with no leading zeros
+		bool ParseIndex(const eastl::string& token, size_t& outIndex)
+		{
+			if (token.empty() || token.size() > 9 || (token[0] == '0' && token.size() > 1))
+				return false;
+
+			outIndex = 0;
+			for (char digit : token)
+			{
+				if (digit < '0' || digit > '9')
+					return false;
+				outIndex = outIndex * 10 + size_t(digit - '0');
+			}
+			return true;
+		}
+
+		// ***********************************************************************
+
+		// Walks the first count tokens from root, returns nullptr if any of them don't exist
+		JsonValue* Resolve(JsonValue& root, const eastl::vector<eastl::string>& tokens, size_t count)
+		{
+			JsonValue* pValue = &root;
+			for (size_t i = 0; i < count && pValue; i++)
+			{
+				size_t index;
+				if (pValue->m_type == JsonValue::Object)
+					pValue = pValue->m_internalData.m_pObject->Find(tokens[i]);
+				else if (pValue->m_type == JsonValue::Array && ParseIndex(tokens[i], index) && index < pValue->m_internalData.m_pArray->size())
+					pValue = &(*pValue->m_internalData.m_pArray)[index];
+				else
+					pValue = nullptr;
+			}
+			return pValue;
+		}
+
+		// ***********************************************************************
+
+		const JsonValue* FindMember(const JsonValue& object, const char* key)
+		{
+			return object.m_type == JsonValue::Object ? object.m_internalData.m_pObject->Find(key) : nullptr;
+		}
+
+		// ***********************************************************************
+
+		void AddOperation(JsonValue& patch, const char* op, const eastl::string& path, const JsonValue* pValue)
+		{
+			JsonValue operation = JsonValue::NewObject();
+			operation["op"] = JsonValue(op);
+			operation["path"] = JsonValue(path);
+			if (pValue)
+				operation["value"] = *pValue;
+			patch.m_internalData.m_pArray->push_back(eastl::move(operation));
+		}
+
+		// ***********************************************************************
+
+		void DiffValues(const JsonValue& from, const JsonValue& to, eastl::string& path, JsonValue& patch)
+		{
+			size_t pathLength = path.size();
+			if (from.m_type == JsonValue::Object && to.m_type == JsonValue::Object)
+			{
+				const JsonObject& fromMembers = *from.m_internalData.m_pObject;
+				const JsonObject& toMembers = *to.m_internalData.m_pObject;
+				for (const JsonObject::value_type& member : fromMembers)
+				{
+					AppendPointerToken(path, member.first);
+					if (const JsonValue* pTo = toMembers.Find(member.first))
+						DiffValues(member.second, *pTo, path, patch);
+					else
+						AddOperation(patch, "remove", path, nullptr);
+					path.resize(pathLength);
+				}
+				for (const JsonObject::value_type& member : toMembers)
+				{
+					if (fromMembers.Find(member.first) == nullptr)
+					{
+						AppendPointerToken(path, member.first);
+						AddOperation(patch, "add", path, &member.second);
+						path.resize(pathLength);
+					}
+				}
+			}
+			else if (from.m_type == JsonValue::Array && to.m_type == JsonValue::Array)
+			{
+				const JsonArray& fromElements = *from.m_internalData.m_pArray;
+				const JsonArray& toElements = *to.m_internalData.m_pArray;
+
+				// Skip the common start and end, so only the part that changed is compared position by position
+				size_t start = 0;
+				size_t fromEnd = fromElements.size();
+				size_t toEnd = toElements.size();
+				while (start < fromEnd && start < toEnd && JsonValuesEqual(fromElements[start], toElements[start]))
+					start++;
+				while (fromEnd > start && toEnd > start && JsonValuesEqual(fromElements[fromEnd - 1], toElements[toEnd - 1]))
+				{
+					fromEnd--;
+					toEnd--;
+				}
+
+				size_t common = eastl::min(fromEnd, toEnd) - start;
+				for (size_t i = start; i < start + common; i++)
+				{
+					path.append_sprintf("/%zu", i);
+					DiffValues(fromElements[i], toElements[i], path, patch);
+					path.resize(pathLength);
+				}
+
+				// Removing at the same index repeatedly takes out the run of elements after it
+				path.append_sprintf("/%zu", start + common);
+				for (size_t i = start + common; i < fromEnd; i++)
+					AddOperation(patch, "remove", path, nullptr);
+				path.resize(pathLength);
+
+				for (size_t i = start + common; i < toEnd; i++)
+				{
+					path.append_sprintf("/%zu", i);
+					AddOperation(patch, "add", path, &toElements[i]);
+					path.resize(pathLength);
+				}
+			}
+			else if (!JsonValuesEqual(from, to))
+			{
+				AddOperation(patch, "replace", path, &to);
+			}
+		}
+
+		// ***********************************************************************
+
+		bool AddValue(JsonValue& document, const eastl::vector<eastl::string>& tokens, const JsonValue& value)
+		{
+			if (tokens.empty())
+			{
+				document = value;
+				return true;
+			}
+
+			JsonValue* pParent = Resolve(document, tokens, tokens.size() - 1);
+			if (pParent == nullptr)
+				return false;
+
+			// Adding to an object replaces any member that's already there
+			const eastl::string& last = tokens.back();
+			if (pParent->m_type == JsonValue::Object)
+			{
+				(*pParent)[last] = value;
+				return true;
+			}
+
+			size_t index;
+			if (pParent->m_type != JsonValue::Array)
+				return false;
+			if (last == "-")
+				index = pParent->m_internalData.m_pArray->size();
+			else if (!ParseIndex(last, index) || index > pParent->m_internalData.m_pArray->size())
+				return false;
+			pParent->Insert(index, value);
+			return true;
+		}
+
+		// ***********************************************************************
+
+		bool RemoveValue(JsonValue& document, const eastl::vector<eastl::string>& tokens)
+		{
+			if (tokens.empty())
+				return false;
+
+			JsonValue* pParent = Resolve(document, tokens, tokens.size() - 1);
+			if (pParent == nullptr)
+				return false;
+
+			const eastl::string& last = tokens.back();
+			if (pParent->m_type == JsonValue::Object)
+				return pParent->Remove(last);
+
+			size_t index;
+			if (pParent->m_type != JsonValue::Array || !ParseIndex(last, index) || index >= pParent->m_internalData.m_pArray->size())
+				return false;
+			pParent->Remove(index);
+			return true;
+		}
+
+		// ***********************************************************************
+
+		bool ApplyOperation(JsonValue& document, const JsonValue& operation, eastl::vector<eastl::string>& tokens, eastl::vector<eastl::string>& fromTokens)
+		{
+			const JsonValue* pOp = FindMember(operation, "op");
+			const JsonValue* pPath = FindMember(operation, "path");
+			if (pOp == nullptr || pPath == nullptr || pOp->m_type != JsonValue::String || pPath->m_type != JsonValue::String)
+			{
+				Log::Crit("Json patch operations need an op and a path");
+				return false;
+			}
+
+			eastl::string_view op = pOp->ToString();
+			eastl::string_view path = pPath->ToString();
+			if (!SplitPointer(path, tokens))
+			{
+				Log::Crit("Json patch path \"%s\" is not a valid JSON Pointer", path.data());
+				return false;
+			}
+
+			bool success = false;
+			if (op == "add" || op == "replace" || op == "test")
+			{
+				const JsonValue* pValue = FindMember(operation, "value");
+				if (pValue == nullptr)
+				{
+					Log::Crit("Json patch %s operation on \"%s\" has no value", op.data(), path.data());
+					return false;
+				}
+
+				if (op == "add")
+				{
+					success = AddValue(document, tokens, *pValue);
+				}
+				else
+				{
+					JsonValue* pTarget = Resolve(document, tokens, tokens.size());
+					if (op == "replace" && pTarget)
+					{
+						*pTarget = *pValue;
+						success = true;
+					}
+					else if (op == "test")
+					{
+						success = pTarget && JsonValuesEqual(*pTarget, *pValue);
+					}
+				}
+			}
+			else if (op == "remove")
+			{
+				success = RemoveValue(document, tokens);
+			}
+			else if (op == "move" || op == "copy")
+			{
+				const JsonValue* pFrom = FindMember(operation, "from");
+				if (pFrom == nullptr || pFrom->m_type != JsonValue::String || !SplitPointer(pFrom->ToString(), fromTokens))
+				{
+					Log::Crit("Json patch %s operation on \"%s\" needs a valid from path", op.data(), path.data());
+					return false;
+				}
+
+				// A value can't be moved inside itself
+				eastl::string_view from = pFrom->ToString();
+				bool intoItself = path.size() > from.size() && path.substr(0, from.size()) == from && path[from.size()] == '/';
+
+				JsonValue* pSource = Resolve(document, fromTokens, fromTokens.size());
+				if (pSource && !(op == "move" && intoItself))
+				{
+					// Copied out first, as removing it, or adding it somewhere else, can move it in memory
+					JsonValue value = *pSource;
+					success = (op == "copy" || RemoveValue(document, fromTokens)) && AddValue(document, tokens, value);
+				}
+			}
+			else
+			{
+				Log::Crit("Json patch operation \"%s\" is not supported", op.data());
+				return false;
+			}
+
+			if (!success)
+				Log::Crit("Json patch %s operation on \"%s\" failed", op.data(), path.data());
+			return success;
+		}
+	}
+
+	// ***********************************************************************
+
+	bool JsonValuesEqual(const JsonValue& a, const JsonValue& b)
+	{
+		bool aIsNumber = a.m_type == JsonValue::Integer || a.m_type == JsonValue::Floating;
+		bool bIsNumber = b.m_type == JsonValue::Integer || b.m_type == JsonValue::Floating;
+		if (aIsNumber && bIsNumber)
+		{
+			if (a.m_type == JsonValue::Integer && b.m_type == JsonValue::Integer)
+				return a.m_internalData.m_integerNumber == b.m_internalData.m_integerNumber;
+			return a.ToFloat() == b.ToFloat();
+		}
+		if (a.m_type != b.m_type)
+			return false;
+
+		switch (a.m_type)
+		{
+		case JsonValue::Object:
+		{
+			const JsonObject& aMembers = *a.m_internalData.m_pObject;
+			const JsonObject& bMembers = *b.m_internalData.m_pObject;
+			if (aMembers.size() != bMembers.size())
+				return false;
+			for (const JsonObject::value_type& member : aMembers)
+			{
+				const JsonValue* pOther = bMembers.Find(member.first);
+				if (pOther == nullptr || !JsonValuesEqual(member.second, *pOther))
+					return false;
+			}
+			return true;
+		}
+		case JsonValue::Array:
+		{
+			const JsonArray& aElements = *a.m_internalData.m_pArray;
+			const JsonArray& bElements = *b.m_internalData.m_pArray;
+			if (aElements.size() != bElements.size())
+				return false;
+			for (size_t i = 0; i < aElements.size(); i++)
+			{
+				if (!JsonValuesEqual(aElements[i], bElements[i]))
+					return false;
+			}
+			return true;
+		}
+		case JsonValue::String:
+			return a.ToString() == b.ToString();
+		case JsonValue::Boolean:
+			return a.m_internalData.m_boolean == b.m_internalData.m_boolean;
+		default:
+			return true;
+		}
+	}
+
+	// ***********************************************************************
+
+	JsonValue JsonDiff(const JsonValue& from, const JsonValue& to)
+	{
+		JsonValue patch = JsonValue::NewArray();
+		eastl::string path;
+		DiffValues(from, to, path, patch);
+		return patch;
+	}
+
+	// ***********************************************************************
+
+	bool JsonApplyPatch(JsonValue& document, const JsonValue& patch)
+	{
+		if (patch.m_type != JsonValue::Array)
+		{
+			Log::Crit("Json patches must be an array of operations");
+			return false;
+		}
+
+		// Token storage is shared by all the operations, so paths don't allocate once it's grown
+		eastl::vector<eastl::string> tokens;
+		eastl::vector<eastl::string> fromTokens;
+		for (const JsonValue& operation : *patch.m_internalData.m_pArray)
+		{
+			if (!ApplyOperation(document, operation, tokens, fromTokens))
+				return false;
+		}
+		return true;
+	}
+
+	// ***********************************************************************
+
+	void WriteJsonPatchLogEntry(FileStream& log, const JsonValue& patch)
+	{
+		// Saves with no changes don't need an entry
+		if (patch.m_type == JsonValue::Array && patch.Count() == 0)
+			return;
+
+		// Compact json never contains a newline, so one entry is one line
+		eastl::string entry = SerializeJsonValue(patch, JsonWriter::Style::Compact);
+		entry.push_back('\n');
+		log.Write(entry.data(), entry.size());
+	}
+
+	// ***********************************************************************
+
+	bool ReplayJsonPatchLog(const char* text, size_t length, JsonValue& document)
+	{
+		const char* end = text + length;
+		int entry = 1;
+		for (const char* line = text; line < end; entry++)
+		{
+			const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+			if (lineEnd == nullptr)
+			{
+				Log::Warn("Ignoring patch log entry %i, it was not completely written", entry);
+				break;
+			}
+
+			if (lineEnd > line)
+			{
+				JsonValue patch = ParseJsonFile(line, lineEnd - line);
+				if (!JsonApplyPatch(document, patch))
+				{
+					Log::Crit("Patch log entry %i could not be applied", entry);
+					return false;
+				}
+			}
+			line = lineEnd + 1;
+		}
+		return true;
+	}
+}
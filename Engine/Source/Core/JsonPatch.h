@@ -0,0 +1,40 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Json.h"
+
+#include <EASTL/string.h>
+
+namespace An
+{
+    class FileStream;
+
+    // JSON Patch (RFC 6902), for saving the changes to a large document rather than rewriting all of it.
+    // A patch is an array of operations like { "op": "replace", "path": "/entities/3/position", "value": [0, 1, 0] },
+    // with paths in JSON Pointer syntax. All six operations, add, remove, replace, move, copy and test, can be applied.
+    ///////////////////////
+
+    // Deep comparison, numbers are equal if their values are, whether they were parsed as integers or not
+    bool JsonValuesEqual(const JsonValue& a, const JsonValue& b);
+
+    // Makes a patch that turns from into to. Only add, remove and replace are generated. Arrays are compared element
+    // by element after skipping any common start and end, so inserting or removing a few elements stays a small patch.
+    JsonValue JsonDiff(const JsonValue& from, const JsonValue& to);
+
+    // Applies each operation in order, stopping at the first that fails, which is logged. Unlike the RFC this does not
+    // roll back the operations before it, as that would mean copying the whole document up front.
+    bool JsonApplyPatch(JsonValue& document, const JsonValue& patch);
+
+    // Patch logs are an append-only file of patches, one compact json array per line, written next to a base document.
+    // Each save appends the diff from the last one, loading replays the log over the base, and compacting is saving
+    // the patched document as the new base and emptying the log.
+    ///////////////////////
+
+    // Appends patch as one line. The stream should be opened with FileAppend, and can stay open between saves.
+    void WriteJsonPatchLogEntry(FileStream& log, const JsonValue& patch);
+
+    // Applies every patch in the log's text to document in order. A final line with no newline was cut off part way
+    // through being written, so it's ignored.
+    bool ReplayJsonPatchLog(const char* text, size_t length, JsonValue& document);
+}
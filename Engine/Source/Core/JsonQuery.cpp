@@ -0,0 +1,220 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonQuery.h"
+
+#include "Log.h"
+
+namespace An
+{
+	// ***********************************************************************
+
+	JsonQuery::JsonQuery()
+	{
+	}
+
+	// ***********************************************************************
+
+	JsonQuery::JsonQuery(eastl::string_view pointer)
+	{
+		Compile(pointer);
+	}
+
+	// ***********************************************************************
+
+	bool JsonQuery::Compile(eastl::string_view pointer)
+	{
+		m_keys.clear();
+		m_tokens.clear();
+		m_isValid = false;
+
+		if (!pointer.empty() && pointer[0] != '/')
+		{
+			Log::Crit("Json query \"%.*s\" must be empty or start with '/'", (int)pointer.size(), pointer.data());
+			return false;
+		}
+
+		// Keys are all unescaped into one string so the tokens don't need an allocation each
+		m_keys.reserve(pointer.size());
+		size_t cursor = 0;
+		while (cursor < pointer.size())
+		{
+			cursor++; // The '/'
+			Token token;
+			token.m_keyOffset = (uint32_t)m_keys.size();
+			bool escaped = false;
+			while (cursor < pointer.size() && pointer[cursor] != '/')
+			{
+				char c = pointer[cursor++];
+				if (c == '~')
+				{
+					char escape = cursor < pointer.size() ? pointer[cursor++] : '\0';
+					if (escape != '0' && escape != '1')
+					{
+						Log::Crit("Json query \"%.*s\" has an invalid escape, only ~0 and ~1 are allowed", (int)pointer.size(), pointer.data());
+						m_keys.clear();
+						m_tokens.clear();
+						return false;
+					}
+					c = escape == '0' ? '~' : '/';
+					escaped = true;
+				}
+				m_keys.push_back(c);
+			}
+			token.m_keyLength = (uint32_t)m_keys.size() - token.m_keyOffset;
+
+			eastl::string_view key = Key(token);
+			token.m_hash = HashJsonKey(key);
+			token.m_isWildcard = !escaped && key == "*";
+
+			// Indices are decimal with no leading zeros, anything else can only be a key. "-" names the element after
+			// the end of an array, which never exists to be read, so it's left as a key too.
+			token.m_index = UINT32_MAX;
+			if (!key.empty() && key.size() <= 9 && (key[0] != '0' || key.size() == 1))
+			{
+				uint32_t index = 0;
+				bool isIndex = true;
+				for (char digit : key)
+				{
+					isIndex = isIndex && digit >= '0' && digit <= '9';
+					index = index * 10 + uint32_t(digit - '0');
+				}
+				if (isIndex)
+					token.m_index = index;
+			}
+			m_tokens.push_back(token);
+		}
+
+		m_isValid = true;
+		return true;
+	}
+
+	// ***********************************************************************
+
+	const JsonValue* JsonQuery::Find(const JsonValue& root) const
+	{
+		const JsonValue* pResult = nullptr;
+		if (m_isValid)
+		{
+			auto visit = [&pResult](const JsonValue* pValue) { pResult = pValue; return false; };
+			Walk(&root, 0, visit);
+		}
+		return pResult;
+	}
+
+	// ***********************************************************************
+
+	JsonLazyValue JsonQuery::Find(JsonLazyValue root) const
+	{
+		JsonLazyValue result;
+		if (m_isValid)
+		{
+			auto visit = [&result](JsonLazyValue value) { result = value; return false; };
+			Walk(root, 0, visit);
+		}
+		return result;
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonQuery::Find(JsonBinaryValue root) const
+	{
+		JsonBinaryValue result;
+		if (m_isValid)
+		{
+			auto visit = [&result](JsonBinaryValue value) { result = value; return false; };
+			Walk(root, 0, visit);
+		}
+		return result;
+	}
+
+	// ***********************************************************************
+
+	const JsonValue* JsonQuery::Step(const JsonValue* pValue, const Token& token) const
+	{
+		if (pValue->m_type == JsonValue::Object)
+			return pValue->m_internalData.m_pObject->Find(Key(token), token.m_hash);
+
+		if (pValue->m_type == JsonValue::Array && token.m_index < pValue->m_internalData.m_pArray->size())
+			return &(*pValue->m_internalData.m_pArray)[token.m_index];
+
+		return nullptr;
+	}
+
+	// ***********************************************************************
+
+	JsonLazyValue JsonQuery::Step(JsonLazyValue value, const Token& token) const
+	{
+		// Lazy documents don't hash their keys, but most objects are small and keys are compared by length first anyway
+		JsonValue::Type type = value.GetType();
+		if (type == JsonValue::Object)
+			return value[Key(token)];
+
+		if (type == JsonValue::Array && token.m_index < (uint32_t)value.Count())
+			return value.ValueAt(token.m_index);
+
+		return JsonLazyValue();
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonQuery::Step(JsonBinaryValue value, const Token& token) const
+	{
+		JsonValue::Type type = value.GetType();
+		if (type == JsonValue::Object)
+			return value.Find(Key(token), token.m_hash);
+
+		if (type == JsonValue::Array && token.m_index < (uint32_t)value.Count())
+			return value.ValueAt(token.m_index);
+
+		return JsonBinaryValue();
+	}
+
+	// ***********************************************************************
+
+	uint32_t JsonQuery::ChildCount(const JsonValue* pValue)
+	{
+		if (pValue->m_type == JsonValue::Object)
+			return (uint32_t)pValue->m_internalData.m_pObject->size();
+		if (pValue->m_type == JsonValue::Array)
+			return (uint32_t)pValue->m_internalData.m_pArray->size();
+		return 0;
+	}
+
+	// ***********************************************************************
+
+	uint32_t JsonQuery::ChildCount(JsonLazyValue value)
+	{
+		return value.m_container != UINT32_MAX ? (uint32_t)value.Count() : 0;
+	}
+
+	// ***********************************************************************
+
+	uint32_t JsonQuery::ChildCount(JsonBinaryValue value)
+	{
+		JsonValue::Type type = value.GetType();
+		return type == JsonValue::Object || type == JsonValue::Array ? (uint32_t)value.Count() : 0;
+	}
+
+	// ***********************************************************************
+
+	const JsonValue* JsonQuery::ChildAt(const JsonValue* pValue, uint32_t index)
+	{
+		if (pValue->m_type == JsonValue::Object)
+			return &pValue->m_internalData.m_pObject->m_members[index].second;
+		return &(*pValue->m_internalData.m_pArray)[index];
+	}
+
+	// ***********************************************************************
+
+	JsonLazyValue JsonQuery::ChildAt(JsonLazyValue value, uint32_t index)
+	{
+		return value.ValueAt(index);
+	}
+
+	// ***********************************************************************
+
+	JsonBinaryValue JsonQuery::ChildAt(JsonBinaryValue value, uint32_t index)
+	{
+		return value.ValueAt(index);
+	}
+}
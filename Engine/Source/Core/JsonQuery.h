@@ -0,0 +1,141 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Json.h"
+#include "JsonBinary.h"
+#include "JsonLazy.h"
+
+#include <EASTL/string.h>
+#include <EASTL/string_view.h>
+#include <EASTL/vector.h>
+#include <stdint.h>
+
+namespace An
+{
+    // A JSON Pointer (RFC 6901) compiled once for lookups that are repeated over many documents or array elements,
+    // e.g. JsonQuery("/pbrMetallicRoughness/baseColorTexture/index") evaluated on every material.
+    // The pointer is split and unescaped, array indices parsed and keys hashed up front, so evaluating it never
+    // parses, hashes or allocates. As an extension a "*" token matches every element of an array or member of an
+    // object, which is most useful with ForEach. An empty pointer matches the root itself.
+    struct JsonQuery
+    {
+        JsonQuery();
+        JsonQuery(eastl::string_view pointer);
+
+        // Returns false, and logs why, if the pointer is not valid. The query then matches nothing.
+        bool Compile(eastl::string_view pointer);
+
+        bool IsValid() const { return m_isValid; }
+
+        // The first match in document order, nullptr or a null value if there are none
+        const JsonValue* Find(const JsonValue& root) const;
+        JsonLazyValue Find(JsonLazyValue root) const;
+        JsonBinaryValue Find(JsonBinaryValue root) const;
+
+        // Calls func on every match in document order, with a const JsonValue& or the view type being queried
+        template<typename Func>
+        void ForEach(const JsonValue& root, Func func) const;
+        template<typename Func>
+        void ForEach(JsonLazyValue root, Func func) const;
+        template<typename Func>
+        void ForEach(JsonBinaryValue root, Func func) const;
+
+    private:
+        struct Token
+        {
+            uint32_t m_keyOffset; // Where the unescaped token is in m_keys
+            uint32_t m_keyLength;
+            uint32_t m_hash; // HashJsonKey of the token
+            uint32_t m_index; // The token as an array index, UINT32_MAX if it isn't one
+            bool m_isWildcard;
+        };
+
+        eastl::string_view Key(const Token& token) const { return eastl::string_view(m_keys.data() + token.m_keyOffset, token.m_keyLength); }
+
+        // Steps from a value to the child named by a token, these return nullptr or a null value if there isn't one
+        const JsonValue* Step(const JsonValue* pValue, const Token& token) const;
+        JsonLazyValue Step(JsonLazyValue value, const Token& token) const;
+        JsonBinaryValue Step(JsonBinaryValue value, const Token& token) const;
+
+        // For expanding wildcards, the number of children is 0 for anything that isn't an array or object
+        static uint32_t ChildCount(const JsonValue* pValue);
+        static uint32_t ChildCount(JsonLazyValue value);
+        static uint32_t ChildCount(JsonBinaryValue value);
+        static const JsonValue* ChildAt(const JsonValue* pValue, uint32_t index);
+        static JsonLazyValue ChildAt(JsonLazyValue value, uint32_t index);
+        static JsonBinaryValue ChildAt(JsonBinaryValue value, uint32_t index);
+
+        static bool IsMissing(const JsonValue* pValue) { return pValue == nullptr; }
+        static bool IsMissing(JsonLazyValue value) { return value.m_pDocument == nullptr; }
+        static bool IsMissing(JsonBinaryValue value) { return value.m_pData == nullptr; }
+
+        // Walks the tokens from first onwards, calling visit on each match until it returns false.
+        // Returns false if the walk was stopped.
+        template<typename Value, typename Visit>
+        bool Walk(Value value, size_t first, Visit& visit) const;
+
+        eastl::string m_keys;
+        eastl::vector<Token> m_tokens;
+        bool m_isValid{ true };
+    };
+
+    // ***********************************************************************
+
+    template<typename Value, typename Visit>
+    bool JsonQuery::Walk(Value value, size_t first, Visit& visit) const
+    {
+        for (size_t i = first; i < m_tokens.size(); i++)
+        {
+            if (IsMissing(value))
+                return true;
+
+            const Token& token = m_tokens[i];
+            if (token.m_isWildcard)
+            {
+                uint32_t count = ChildCount(value);
+                for (uint32_t child = 0; child < count; child++)
+                {
+                    if (!Walk(ChildAt(value, child), i + 1, visit))
+                        return false;
+                }
+                return true;
+            }
+            value = Step(value, token);
+        }
+        return IsMissing(value) || visit(value);
+    }
+
+    // ***********************************************************************
+
+    template<typename Func>
+    void JsonQuery::ForEach(const JsonValue& root, Func func) const
+    {
+        if (!m_isValid)
+            return;
+        auto visit = [&func](const JsonValue* pValue) { func(*pValue); return true; };
+        Walk(&root, 0, visit);
+    }
+
+    // ***********************************************************************
+
+    template<typename Func>
+    void JsonQuery::ForEach(JsonLazyValue root, Func func) const
+    {
+        if (!m_isValid)
+            return;
+        auto visit = [&func](JsonLazyValue value) { func(value); return true; };
+        Walk(root, 0, visit);
+    }
+
+    // ***********************************************************************
+
+    template<typename Func>
+    void JsonQuery::ForEach(JsonBinaryValue root, Func func) const
+    {
+        if (!m_isValid)
+            return;
+        auto visit = [&func](JsonBinaryValue value) { func(value); return true; };
+        Walk(root, 0, visit);
+    }
+}
@@ -0,0 +1,418 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonReader.h"
+
+#include "FileStream.h"
+#include "JsonScanner.h"
+#include "Log.h"
+#include "NumberParsing.h"
+
+#include <string.h>
+
+namespace An
+{
+	// ***********************************************************************
+
+	JsonReader::JsonReader(JsonHandler& handler)
+		: m_handler(handler)
+	{
+	}
+
+	// ***********************************************************************
+
+	bool JsonReader::Read(const char* text, size_t length)
+	{
+		Reset();
+		return Process(text, length, true) == Status::Complete;
+	}
+
+	// ***********************************************************************
+
+	bool JsonReader::Read(FileStream& stream, size_t bufferSize)
+	{
+		Begin();
+		if (!stream.IsValid())
+			return false;
+
+		eastl::vector<char> buffer(bufferSize);
+		size_t remaining = stream.Size() - stream.Tell();
+		while (remaining > 0)
+		{
+			size_t toRead = eastl::min(buffer.size(), remaining);
+			stream.Read(buffer.data(), toRead);
+			remaining -= toRead;
+			if (!Feed(buffer.data(), toRead))
+				break;
+		}
+		return Finish();
+	}
+
+	// ***********************************************************************
+
+	void JsonReader::Begin()
+	{
+		Reset();
+		m_status = Status::NeedMoreInput;
+		m_pending.clear();
+	}
+
+	// ***********************************************************************
+
+	bool JsonReader::Feed(const char* text, size_t length)
+	{
+		// Anything after the end of the document is ignored, as it is by Read
+		if (m_status != Status::NeedMoreInput)
+			return m_status == Status::Complete;
+
+		if (m_pending.empty())
+		{
+			// Usually the chunk can be read where it is, and only an unfinished token at the end needs keeping
+			m_status = Process(text, length, false);
+			if (m_status == Status::NeedMoreInput)
+				m_pending.assign((const char*)m_scan.current, text + length);
+		}
+		else
+		{
+			m_pending.insert(m_pending.end(), text, text + length);
+			m_status = Process(m_pending.data(), m_pending.size(), false);
+			if (m_status == Status::NeedMoreInput)
+				m_pending.erase(m_pending.begin(), m_pending.begin() + (m_scan.current - m_pending.data()));
+			else
+				m_pending.clear();
+		}
+		return m_status == Status::NeedMoreInput || m_status == Status::Complete;
+	}
+
+	// ***********************************************************************
+
+	bool JsonReader::Finish()
+	{
+		if (m_status == Status::NeedMoreInput)
+			m_status = Process(m_pending.data(), m_pending.size(), true);
+		m_pending.clear();
+		return m_status == Status::Complete;
+	}
+
+	// ***********************************************************************
+
+	void JsonReader::Reset()
+	{
+		m_state = State::Value;
+		m_containers.clear();
+		m_scan.line = 1;
+		m_scan.encounteredError = false;
+		m_stringScanned = 0;
+		m_stringHasEscapes = false;
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::Error(const char* message)
+	{
+		Log::Crit("Json parse error on line %i: %s", m_scan.line, message);
+		m_scan.encounteredError = true;
+		return Status::Error;
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::Process(const char* text, size_t length, bool isFinal)
+	{
+		// Only the line count carries over from earlier text
+		m_scan.textStart = text;
+		m_scan.textEnd = text + length;
+		m_scan.current = (char*)text;
+		m_scan.currentLineStart = m_scan.current;
+		return Process(isFinal);
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::Process(bool isFinal)
+	{
+		// Each step either consumes a whole token, or leaves the cursor at the start of a token that isn't
+		// all there yet, so it can be picked up again once there is more input
+		Scan::ScanningState& scan = m_scan;
+		while (m_state != State::Done)
+		{
+			if (!SkipWhitespaceAndComments(isFinal))
+				return Status::NeedMoreInput;
+			if (Scan::IsAtEnd(scan))
+			{
+				if (!isFinal)
+					return Status::NeedMoreInput;
+				return Error(m_containers.empty() ? "Expected a value" : "Unexpected end of json");
+			}
+
+			char c = Scan::Peek(scan);
+			Status status = Status::Complete;
+			switch (m_state)
+			{
+			case State::FirstKey:
+				if (c == '}')
+					status = EndContainer(c);
+				else
+					status = ReadKey(isFinal);
+				break;
+			case State::Colon:
+				if (c != ':')
+					return Error("Expected colon");
+				Scan::Advance(scan);
+				m_state = State::Value;
+				break;
+			case State::FirstValue:
+				if (c == ']')
+				{
+					status = EndContainer(c);
+					break;
+				}
+				[[fallthrough]];
+			case State::Value:
+				if (c == '{' || c == '[')
+				{
+					Scan::Advance(scan);
+					m_containers.push_back(c);
+					m_state = c == '{' ? State::FirstKey : State::FirstValue;
+					if (!(c == '{' ? m_handler.StartObject() : m_handler.StartArray()))
+						return Status::Stopped;
+				}
+				else
+				{
+					status = ReadScalar(isFinal);
+				}
+				break;
+			case State::CommaOrEnd:
+				// Trailing commas are allowed, so a comma can be followed by the end of the container
+				if (c == ',')
+				{
+					Scan::Advance(scan);
+					m_state = m_containers.back() == '{' ? State::FirstKey : State::FirstValue;
+				}
+				else if (c == '}' || c == ']')
+				{
+					status = EndContainer(c);
+				}
+				else
+				{
+					return Error(m_containers.back() == '{' ? "Expected comma or Right Curly Brace" : "Expected comma or right bracket");
+				}
+				break;
+			default:
+				break;
+			}
+
+			if (status != Status::Complete)
+				return status;
+		}
+		return Status::Complete;
+	}
+
+	// ***********************************************************************
+
+	bool JsonReader::SkipWhitespaceAndComments(bool isFinal)
+	{
+		// Returns false when stopped part way into a comment that needs more input to finish
+		Scan::ScanningState& scan = m_scan;
+		while (!Scan::IsAtEnd(scan))
+		{
+			char c = Scan::Peek(scan);
+			if (Scan::IsWhitespace(c))
+			{
+				JsonScan::SkipWhitespace(scan);
+				continue;
+			}
+			if (c != '/')
+				return true;
+
+			// Can't tell if this is a comment yet
+			if (scan.current + 1 >= scan.textEnd)
+				return isFinal;
+
+			if (scan.current[1] == '/')
+			{
+				const char* newline = (const char*)memchr(scan.current + 2, '\n', scan.textEnd - (scan.current + 2));
+				if (newline == nullptr && !isFinal)
+					return false;
+				scan.current = newline ? (char*)newline : (char*)scan.textEnd;
+			}
+			else if (scan.current[1] == '*')
+			{
+				const char* commentEnd = scan.current + 2;
+				while (commentEnd + 1 < scan.textEnd && !(commentEnd[0] == '*' && commentEnd[1] == '/'))
+					commentEnd++;
+				if (commentEnd + 1 >= scan.textEnd && !isFinal)
+					return false;
+
+				for (const char* pos = scan.current; pos < commentEnd; pos++)
+					scan.line += *pos == '\n';
+				scan.current = commentEnd + 2 < scan.textEnd ? (char*)commentEnd + 2 : (char*)scan.textEnd;
+			}
+			else
+			{
+				return true;
+			}
+		}
+		return true;
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::EndContainer(char closer)
+	{
+		char opener = closer == '}' ? '{' : '[';
+		if (m_containers.back() != opener)
+			return Error(closer == '}' ? "Unexpected Right Curly Brace" : "Unexpected right bracket");
+
+		Scan::Advance(m_scan);
+		m_containers.pop_back();
+		m_state = m_containers.empty() ? State::Done : State::CommaOrEnd;
+
+		if (!(closer == '}' ? m_handler.EndObject() : m_handler.EndArray()))
+			return Status::Stopped;
+		return Status::Complete;
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::ReadKey(bool isFinal)
+	{
+		Scan::ScanningState& scan = m_scan;
+		char c = Scan::Peek(scan);
+
+		eastl::string_view key;
+		if (c == '"' || c == '\'')
+		{
+			Status status = ReadString(isFinal, key);
+			if (status != Status::Complete)
+				return status;
+		}
+		else if (Scan::IsAlpha(c))
+		{
+			char* start = scan.current;
+			while (!Scan::IsAtEnd(scan) && Scan::IsAlphaNumeric(Scan::Peek(scan)))
+				Scan::Advance(scan);
+
+			if (Scan::IsAtEnd(scan) && !isFinal)
+			{
+				scan.current = start;
+				return Status::NeedMoreInput;
+			}
+			key = eastl::string_view(start, scan.current - start);
+		}
+		else
+		{
+			return Error("Expected identifier or string");
+		}
+
+		m_state = State::Colon;
+		return m_handler.Key(key) ? Status::Complete : Status::Stopped;
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::ReadScalar(bool isFinal)
+	{
+		Scan::ScanningState& scan = m_scan;
+		char c = Scan::Peek(scan);
+		char* start = scan.current;
+		bool keepReading = true;
+
+		if (c == '"' || c == '\'')
+		{
+			eastl::string_view string;
+			Status status = ReadString(isFinal, string);
+			if (status != Status::Complete)
+				return status;
+			keepReading = m_handler.String(string);
+		}
+		else if (Scan::IsDigit(c) || c == '+' || c == '-' || c == '.')
+		{
+			// Gather the whole lexeme first, so we know it's complete, including json5 hex numbers
+			while (!Scan::IsAtEnd(scan) && (Scan::IsAlphaNumeric(Scan::Peek(scan)) || Scan::Peek(scan) == '.' || Scan::Peek(scan) == '+' || Scan::Peek(scan) == '-'))
+				Scan::Advance(scan);
+			if (Scan::IsAtEnd(scan) && !isFinal)
+			{
+				scan.current = start;
+				return Status::NeedMoreInput;
+			}
+
+			ParsedNumber number;
+			if (ParseNumber(start, scan.current, number) != scan.current)
+				return Error("Invalid number");
+			keepReading = number.m_isInteger ? m_handler.Integer(number.m_integer) : m_handler.Floating(number.m_floating);
+		}
+		else if (Scan::IsAlpha(c))
+		{
+			while (!Scan::IsAtEnd(scan) && Scan::IsAlphaNumeric(Scan::Peek(scan)))
+				Scan::Advance(scan);
+			if (Scan::IsAtEnd(scan) && !isFinal)
+			{
+				scan.current = start;
+				return Status::NeedMoreInput;
+			}
+
+			size_t length = scan.current - start;
+			if (length == 4 && memcmp(start, "true", 4) == 0)
+				keepReading = m_handler.Boolean(true);
+			else if (length == 5 && memcmp(start, "false", 5) == 0)
+				keepReading = m_handler.Boolean(false);
+			else if (length == 4 && memcmp(start, "null", 4) == 0)
+				keepReading = m_handler.Null();
+			else
+				return Error("Unexpected identifier");
+		}
+		else
+		{
+			return Error("Unexpected character");
+		}
+
+		m_state = m_containers.empty() ? State::Done : State::CommaOrEnd;
+		return keepReading ? Status::Complete : Status::Stopped;
+	}
+
+	// ***********************************************************************
+
+	JsonReader::Status JsonReader::ReadString(bool isFinal, eastl::string_view& outString)
+	{
+		Scan::ScanningState& scan = m_scan;
+		char bound = Scan::Peek(scan);
+		char* start = scan.current + 1;
+
+		// Carry on from wherever the string was cut off by the end of the last chunk
+		const char* end = start + m_stringScanned;
+		bool hasEscapes = m_stringHasEscapes;
+		while (true)
+		{
+			end = JsonScan::FindQuoteOrBackslash(end, scan.textEnd, bound);
+			if (end + 1 >= scan.textEnd && (end == scan.textEnd || *end == '\\'))
+			{
+				if (isFinal)
+					return Error("Unterminated string");
+				m_stringScanned = end - start;
+				m_stringHasEscapes = hasEscapes;
+				return Status::NeedMoreInput;
+			}
+			if (*end == bound)
+				break;
+
+			// Skip the backslash and whatever it escapes, which may be the bound
+			hasEscapes = true;
+			end += 2;
+		}
+
+		if (hasEscapes)
+		{
+			m_decoded.resize(end - start);
+			size_t length = JsonScan::DecodeEscapes(scan, start, end, m_decoded.data());
+			outString = eastl::string_view(m_decoded.data(), length);
+		}
+		else
+		{
+			outString = eastl::string_view(start, end - start);
+		}
+		scan.current = (char*)end + 1;
+		m_stringScanned = 0;
+		m_stringHasEscapes = false;
+		return Status::Complete;
+	}
+}
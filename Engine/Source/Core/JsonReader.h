@@ -0,0 +1,95 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Scanning.h"
+
+#include <EASTL/string.h>
+#include <EASTL/string_view.h>
+#include <EASTL/vector.h>
+#include <stdint.h>
+
+namespace An
+{
+    class FileStream;
+
+    // Receives a json document as a stream of events from a JsonReader, in document order.
+    // Strings and keys are only valid for the duration of the call. Return false from any event to stop reading.
+    struct JsonHandler
+    {
+        virtual ~JsonHandler() {}
+
+        virtual bool StartObject() { return true; }
+        virtual bool Key(eastl::string_view key) { return true; }
+        virtual bool EndObject() { return true; }
+        virtual bool StartArray() { return true; }
+        virtual bool EndArray() { return true; }
+
+        virtual bool String(eastl::string_view value) { return true; }
+        virtual bool Integer(int64_t value) { return true; }
+        virtual bool Floating(double value) { return true; }
+        virtual bool Boolean(bool value) { return true; }
+        virtual bool Null() { return true; }
+    };
+
+    // Event based json reader, for when a document doesn't need to be built into JsonValues. Accepts the same json5
+    // extensions as ParseJsonFile. Only the nesting of containers is remembered, so reading from a stream needs memory
+    // for the largest single token, not the whole document.
+    struct JsonReader
+    {
+        JsonReader(JsonHandler& handler);
+
+        // Both return true if the whole document was read without errors, and without the handler stopping early
+        bool Read(const char* text, size_t length);
+        bool Read(FileStream& stream, size_t bufferSize = 64 * 1024);
+
+        // Incremental reading, for text that arrives in pieces. Chunks can be split anywhere, even in the middle of a
+        // token, and only an unfinished token is copied to be kept between calls. Feed returns false once reading has
+        // failed or been stopped, and Finish, called after the last chunk, returns the same as Read would have.
+        void Begin();
+        bool Feed(const char* text, size_t length);
+        bool Finish();
+
+    private:
+        enum class Status
+        {
+            Complete,
+            NeedMoreInput,
+            Error,
+            Stopped
+        };
+
+        enum class State : uint8_t
+        {
+            FirstValue,   // After '[', a value or the end of the array
+            Value,
+            FirstKey,     // After '{', a key or the end of the object
+            Colon,
+            CommaOrEnd,
+            Done
+        };
+
+        void Reset();
+        Status Error(const char* message);
+        Status Process(const char* text, size_t length, bool isFinal);
+        Status Process(bool isFinal);
+        bool SkipWhitespaceAndComments(bool isFinal);
+        Status EndContainer(char closer);
+        Status ReadKey(bool isFinal);
+        Status ReadScalar(bool isFinal);
+        Status ReadString(bool isFinal, eastl::string_view& outString);
+
+        JsonHandler& m_handler;
+        Scan::ScanningState m_scan;
+        State m_state{ State::Value };
+        eastl::vector<char> m_containers; // '{' or '[' for each open container
+        eastl::string m_decoded; // Scratch space for strings that contain escapes
+
+        // Incremental reading state, the unfinished token left over from previous chunks, and how far into it a string
+        // has already been scanned, so long strings spread over many chunks are only scanned once
+        Status m_status{ Status::Complete };
+        eastl::vector<char> m_pending;
+        size_t m_stringScanned{ 0 };
+        bool m_stringHasEscapes{ false };
+    };
+}
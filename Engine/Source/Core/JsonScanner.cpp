@@ -0,0 +1,467 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonScanner.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_SCAN_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace An
+{
+	namespace
+	{
+		// Bit twiddling helpers, masks given to these must not be zero
+		inline int LowestSetBit(uint64_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, mask);
+			return (int)index;
+#else
+			return __builtin_ctzll(mask);
+#endif
+		}
+
+		inline int HighestSetBit(uint64_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, mask);
+			return (int)index;
+#else
+			return 63 - __builtin_clzll(mask);
+#endif
+		}
+
+		inline int CountSetBits(uint64_t mask)
+		{
+#if defined(_MSC_VER)
+			return (int)__popcnt64(mask);
+#else
+			return __builtin_popcountll(mask);
+#endif
+		}
+
+		// A block of 64 bytes loaded into registers, and MatchAny, which gives a mask of every byte equal to any of the given characters.
+		// Comparisons are or'd together per register so there's only one movemask per register regardless of how many characters are matched.
+#if defined(JSON_SCAN_AVX2)
+		struct Block
+		{
+			__m256i m_lanes[2];
+		};
+
+		inline Block LoadBlock(const char* pBlock)
+		{
+			return { { _mm256_loadu_si256((const __m256i*)pBlock), _mm256_loadu_si256((const __m256i*)(pBlock + 32)) } };
+		}
+
+		template<typename... Chars>
+		inline uint64_t MatchAny(const Block& block, Chars... chars)
+		{
+			uint64_t result = 0;
+			for (int i = 0; i < 2; i++)
+			{
+				__m256i matches = _mm256_setzero_si256();
+				((matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block.m_lanes[i], _mm256_set1_epi8(chars)))), ...);
+				result |= (uint64_t)(uint32_t)_mm256_movemask_epi8(matches) << (i * 32);
+			}
+			return result;
+		}
+#elif defined(JSON_SCAN_SSE2)
+		struct Block
+		{
+			__m128i m_lanes[4];
+		};
+
+		inline Block LoadBlock(const char* pBlock)
+		{
+			Block block;
+			for (int i = 0; i < 4; i++)
+				block.m_lanes[i] = _mm_loadu_si128((const __m128i*)(pBlock + i * 16));
+			return block;
+		}
+
+		template<typename... Chars>
+		inline uint64_t MatchAny(const Block& block, Chars... chars)
+		{
+			uint64_t result = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				__m128i matches = _mm_setzero_si128();
+				((matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block.m_lanes[i], _mm_set1_epi8(chars)))), ...);
+				result |= (uint64_t)(uint32_t)_mm_movemask_epi8(matches) << (i * 16);
+			}
+			return result;
+		}
+#else
+		struct Block
+		{
+			const char* m_pBytes;
+		};
+
+		inline Block LoadBlock(const char* pBlock)
+		{
+			return { pBlock };
+		}
+
+		template<typename... Chars>
+		inline uint64_t MatchAny(const Block& block, Chars... chars)
+		{
+			uint64_t result = 0;
+			for (int i = 0; i < 64; i++)
+			{
+				char c = block.m_pBytes[i];
+				if (((c == chars) || ...))
+					result |= 1ull << i;
+			}
+			return result;
+		}
+#endif
+
+		// Reads the four hex digits of a \u escape, returning false if there aren't four
+		bool ReadHex4(const char* cursor, const char* end, uint32_t& outValue)
+		{
+			if (end - cursor < 4)
+				return false;
+
+			outValue = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				char c = cursor[i];
+				uint32_t digit;
+				if (c >= '0' && c <= '9')
+					digit = c - '0';
+				else if (c >= 'a' && c <= 'f')
+					digit = c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					digit = c - 'A' + 10;
+				else
+					return false;
+				outValue = outValue * 16 + digit;
+			}
+			return true;
+		}
+
+		// Returns the number of bytes written, at most 4
+		size_t EncodeUtf8(uint32_t codepoint, char* output)
+		{
+			if (codepoint < 0x80)
+			{
+				output[0] = (char)codepoint;
+				return 1;
+			}
+			if (codepoint < 0x800)
+			{
+				output[0] = (char)(0xC0 | (codepoint >> 6));
+				output[1] = (char)(0x80 | (codepoint & 0x3F));
+				return 2;
+			}
+			if (codepoint < 0x10000)
+			{
+				output[0] = (char)(0xE0 | (codepoint >> 12));
+				output[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+				output[2] = (char)(0x80 | (codepoint & 0x3F));
+				return 3;
+			}
+			output[0] = (char)(0xF0 | (codepoint >> 18));
+			output[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+			output[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+			output[3] = (char)(0x80 | (codepoint & 0x3F));
+			return 4;
+		}
+	}
+
+	// ***********************************************************************
+
+	const char* JsonScan::FindQuoteOrBackslash(const char* cursor, const char* end, char quote)
+	{
+		while (end - cursor >= (ptrdiff_t)BlockSize)
+		{
+			uint64_t matches = MatchAny(LoadBlock(cursor), quote, '\\');
+			if (matches)
+				return cursor + LowestSetBit(matches);
+			cursor += BlockSize;
+		}
+
+		// Less than a block left, finish it off one character at a time
+		while (cursor < end && *cursor != quote && *cursor != '\\')
+			cursor++;
+		return cursor;
+	}
+
+	// ***********************************************************************
+
+	const char* JsonScan::FindStructureCharacter(const char* cursor, const char* end)
+	{
+		while (end - cursor >= (ptrdiff_t)BlockSize)
+		{
+			uint64_t matches = MatchAny(LoadBlock(cursor), '"', '\'', '{', '}', '[', ']', '/');
+			if (matches)
+				return cursor + LowestSetBit(matches);
+			cursor += BlockSize;
+		}
+
+		while (cursor < end)
+		{
+			char c = *cursor;
+			if (c == '"' || c == '\'' || c == '{' || c == '}' || c == '[' || c == ']' || c == '/')
+				break;
+			cursor++;
+		}
+		return cursor;
+	}
+
+	// ***********************************************************************
+
+	const char* JsonScan::SplitArray(const char* cursor, const char* end, size_t chunkSize, eastl::vector<const char*>& outSplits)
+	{
+		// Masks out everything inside strings a block at a time, like simdjson's first stage, so the only characters left
+		// to look at one by one are the brackets, braces and commas that make up the structure
+		const char* chunkStart = cursor + 1;
+		int depth = 0;
+		bool escapesNextBlock = false;
+		uint64_t inString = 0; // All ones if the previous block ended inside a string
+		char padded[BlockSize];
+		for (const char* pBlock = cursor; pBlock < end; pBlock += BlockSize)
+		{
+			// Long strings, like embedded buffers, are skipped over at memory bandwidth. Blocks don't need to be aligned to
+			// anything, so the next one can just start at the end of the string.
+			if (inString && !escapesNextBlock)
+			{
+				pBlock = FindQuoteOrBackslash(pBlock, end, '"');
+				if (pBlock >= end)
+					break;
+			}
+
+			// The last partial block is padded out with spaces, which never match anything
+			const char* pBytes = pBlock;
+			if (end - pBlock < (ptrdiff_t)BlockSize)
+			{
+				memset(padded, ' ', BlockSize);
+				memcpy(padded, pBlock, end - pBlock);
+				pBytes = padded;
+			}
+			Block block = LoadBlock(pBytes);
+
+			// Each backslash escapes the character after it, unless it's escaped itself. Runs of them are rare enough to
+			// walk one at a time.
+			uint64_t escaped = escapesNextBlock ? 1 : 0;
+			uint64_t backslashes = MatchAny(block, '\\') & ~escaped;
+			escapesNextBlock = false;
+			while (backslashes)
+			{
+				int bit = LowestSetBit(backslashes);
+				if (bit == 63)
+				{
+					escapesNextBlock = true;
+					break;
+				}
+				escaped |= 2ull << bit;
+				backslashes &= ~((4ull << bit) - 1);
+			}
+
+			// Prefix xor of the unescaped quotes gives the bytes from each opening quote up to its closing quote
+			uint64_t strings = MatchAny(block, '"') & ~escaped;
+			for (int shift = 1; shift < 64; shift *= 2)
+				strings ^= strings << shift;
+			strings ^= inString;
+			inString = strings >> 63 ? ~0ull : 0;
+
+			if (MatchAny(block, '\'', '/') & ~strings)
+				return nullptr;
+
+			uint64_t structurals = MatchAny(block, '{', '}', '[', ']', ',') & ~strings;
+			while (structurals)
+			{
+				int bit = LowestSetBit(structurals);
+				structurals &= structurals - 1;
+
+				char c = pBytes[bit];
+				if (c == '{' || c == '[')
+				{
+					depth++;
+				}
+				else if (c == '}' || c == ']')
+				{
+					if (--depth == 0)
+						return pBlock + bit;
+				}
+				else if (depth == 1 && pBlock + bit + 1 - chunkStart >= (ptrdiff_t)chunkSize)
+				{
+					chunkStart = pBlock + bit + 1;
+					outSplits.push_back(chunkStart);
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	// ***********************************************************************
+
+	void JsonScan::SkipWhitespace(Scan::ScanningState& scan)
+	{
+		// Most whitespace runs are a single space or newline plus some indentation, so only bother
+		// with blocks once we know we're actually looking at some whitespace
+		if (Scan::IsAtEnd(scan) || !Scan::IsWhitespace(Scan::Peek(scan)))
+			return;
+
+		while (scan.textEnd - scan.current >= (ptrdiff_t)BlockSize)
+		{
+			Block block = LoadBlock(scan.current);
+			uint64_t notWhitespace = ~MatchAny(block, ' ', '\t', '\r', '\n');
+			uint64_t newlines = MatchAny(block, '\n');
+
+			// Only the newlines before the end of the whitespace count
+			int skipped = notWhitespace ? LowestSetBit(notWhitespace) : (int)BlockSize;
+			if (skipped < (int)BlockSize)
+				newlines &= (1ull << skipped) - 1;
+
+			if (newlines)
+			{
+				scan.line += CountSetBits(newlines);
+				scan.currentLineStart = scan.current + HighestSetBit(newlines) + 1;
+			}
+			scan.current += skipped;
+
+			if (notWhitespace)
+				return;
+		}
+
+		while (!Scan::IsAtEnd(scan) && Scan::IsWhitespace(Scan::Peek(scan)))
+		{
+			if (Scan::Advance(scan) == '\n')
+			{
+				scan.line++;
+				scan.currentLineStart = scan.current;
+			}
+		}
+	}
+
+	// ***********************************************************************
+
+	void JsonScan::SkipWhitespaceAndComments(Scan::ScanningState& scan)
+	{
+		while (!Scan::IsAtEnd(scan))
+		{
+			char c = Scan::Peek(scan);
+			switch (c)
+			{
+			case '\n':
+			case ' ':
+			case '\r':
+			case '\t':
+				SkipWhitespace(scan);
+				break;
+
+			// Comments!
+			case '/':
+				if (scan.current + 1 < scan.textEnd && scan.current[1] == '/')
+				{
+					while (!Scan::IsAtEnd(scan) && Scan::Peek(scan) != '\n')
+						Scan::Advance(scan);
+				}
+				else if (scan.current + 1 < scan.textEnd && scan.current[1] == '*')
+				{
+					scan.current += 2;
+					while (scan.current + 1 < scan.textEnd && !(scan.current[0] == '*' && scan.current[1] == '/'))
+					{
+						if (Scan::Advance(scan) == '\n')
+						{
+							scan.line++;
+							scan.currentLineStart = scan.current;
+						}
+					}
+					scan.current = scan.current + 2 < scan.textEnd ? scan.current + 2 : (char*)scan.textEnd;
+				}
+				else
+				{
+					return;
+				}
+				break;
+			default:
+				return;
+			}
+		}
+	}
+
+	// ***********************************************************************
+
+	size_t JsonScan::DecodeEscapes(Scan::ScanningState& scan, const char* cursor, const char* end, char* output)
+	{
+		// Escape sequences only ever shrink the string, so the output is allowed to be the input buffer
+		char* outputStart = output;
+		while (cursor < end)
+		{
+			char c = *(cursor++);
+			if (c == '\n')
+				scan.line++;
+
+			if (c == '\\')
+			{
+				char next = *(cursor++);
+				switch (next)
+				{
+				// Convert basic escape sequences to their actual characters
+				case '\'': *output++ = '\''; break;
+				case '"': *output++ = '"'; break;
+				case '\\':*output++ = '\\'; break;
+				case 'b': *output++ = '\b'; break;
+				case 'f': *output++ = '\f'; break;
+				case 'n': *output++ = '\n'; break;
+				case 'r': *output++ = '\r'; break;
+				case 't': *output++ = '\t'; break;
+				case 'v': *output++ = '\v'; break;
+				case '0': *output++ = '\0'; break;
+
+				// Written out as utf-8, which is never longer than the escape. Surrogate pairs are combined into one
+				// character, and a \u without four hex digits is kept as a plain 'u' like other unknown escapes.
+				case 'u':
+				{
+					uint32_t codepoint;
+					if (!ReadHex4(cursor, end, codepoint))
+					{
+						*output++ = 'u';
+						break;
+					}
+					cursor += 4;
+
+					uint32_t low;
+					if (codepoint >= 0xD800 && codepoint < 0xDC00 && end - cursor >= 6 && cursor[0] == '\\' && cursor[1] == 'u'
+						&& ReadHex4(cursor + 2, end, low) && low >= 0xDC00 && low < 0xE000)
+					{
+						codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+						cursor += 6;
+					}
+					output += EncodeUtf8(codepoint, output);
+					break;
+				}
+
+
+				// Line terminators, allowed but we do not include them in the final string
+				case '\n':
+					scan.line++;
+					break;
+				case '\r':
+					if (cursor < end && *cursor == '\n') // CRLF line endings
+						cursor++;
+					break;
+				default:
+					*output++ =  next; // all other escaped characters are kept as is, without the '\' that preceeded it
+				}
+			}
+			else
+				*output++ = c;
+		}
+		return output - outputStart;
+	}
+}
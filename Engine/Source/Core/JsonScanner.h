@@ -0,0 +1,42 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Scanning.h"
+
+#include <EASTL/vector.h>
+#include <stdint.h>
+
+namespace An::JsonScan
+{
+    // Vectorized character classification for json text, in the style of simdjson's first stage.
+    // Text is classified 64 bytes at a time, using AVX2 or SSE2 where available and a scalar loop otherwise.
+    ///////////////////////
+
+    static constexpr size_t BlockSize = 64;
+
+    // Returns the first quote or backslash at or after cursor, or end if there are none.
+    // This is what lets long strings (i.e. embedded base64 buffers) be skipped at memory bandwidth.
+    const char* FindQuoteOrBackslash(const char* cursor, const char* end, char quote);
+
+    // Returns the first quote, bracket, brace or slash at or after cursor, or end if there are none.
+    // These are the only characters that can open or close a string, container or comment.
+    const char* FindStructureCharacter(const char* cursor, const char* end);
+
+    // Divides the elements of the array whose opening bracket is at cursor into chunks of at least chunkSize bytes, so they
+    // can be parsed in parallel. The start of every chunk after the first is appended to outSplits, each straight after a
+    // comma between two elements. Returns the array's closing bracket, or nullptr if it can't be split reliably, because
+    // it's unterminated or uses single quoted strings or comments, in which case it should just be parsed serially.
+    const char* SplitArray(const char* cursor, const char* end, size_t chunkSize, eastl::vector<const char*>& outSplits);
+
+    // Advances over spaces, tabs and newlines, keeping the scan's line tracking up to date
+    void SkipWhitespace(Scan::ScanningState& scan);
+
+    // Advances over whitespace, and json5 line and block comments
+    void SkipWhitespaceAndComments(Scan::ScanningState& scan);
+
+    // Decodes the escape sequences in a string's contents, from cursor up to end, returning the decoded length. \u escapes
+    // become utf-8.
+    // Escapes only ever shrink the string, so output may be the same buffer as the input to decode in place.
+    size_t DecodeEscapes(Scan::ScanningState& scan, const char* cursor, const char* end, char* output);
+}
@@ -0,0 +1,314 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "JsonWriter.h"
+
+#include "FileStream.h"
+#include "Json.h"
+#include "NumberFormatting.h"
+#include "Scanning.h"
+
+#include <string.h>
+
+namespace An
+{
+	namespace
+	{
+		// Returns the escape character for c, 'u' for control characters that need writing as \u00XX, or 0 if it can be
+		// written as is. Strict json doesn't allow any unescaped control characters in strings.
+		inline char EscapeFor(char c)
+		{
+			switch (c)
+			{
+			case '"': return '"';
+			case '\\': return '\\';
+			case '\n': return 'n';
+			case '\r': return 'r';
+			case '\t': return 't';
+			case '\b': return 'b';
+			case '\f': return 'f';
+			default: return (unsigned char)c < 0x20 ? 'u' : 0;
+			}
+		}
+
+		// ***********************************************************************
+
+		size_t EscapedLength(eastl::string_view string)
+		{
+			size_t length = string.size();
+			for (char c : string)
+			{
+				char escape = EscapeFor(c);
+				if (escape == 'u')
+					length += 5;
+				else if (escape != 0)
+					length += 1;
+			}
+			return length;
+		}
+
+		// ***********************************************************************
+
+		bool IsIdentifier(eastl::string_view key)
+		{
+			if (key.empty() || !Scan::IsAlpha(key[0]))
+				return false;
+			for (char c : key)
+			{
+				if (!Scan::IsAlphaNumeric(c))
+					return false;
+			}
+			return true;
+		}
+
+		// ***********************************************************************
+
+		// Buffer needs room for MaxNumberLength + 1 characters
+		size_t FormatNumber(const JsonValue& value, char* buffer)
+		{
+			if (value.m_type == JsonValue::Integer)
+				return FormatInt(value.m_internalData.m_integerNumber, buffer);
+
+			// Json has no way to write NaN or infinities, so they're written as null like javascript does
+			double number = value.m_internalData.m_floatingNumber;
+			if (number - number != 0.0)
+			{
+				memcpy(buffer, "null", 5);
+				return 4;
+			}
+			return FormatFloat(number, buffer);
+		}
+	}
+
+	// ***********************************************************************
+
+	JsonWriter::JsonWriter(eastl::string& output, Style style)
+		: m_pOutput(&output)
+		, m_style(style)
+	{
+	}
+
+	// ***********************************************************************
+
+	JsonWriter::JsonWriter(FileStream& stream, Style style)
+		: m_pOutput(&m_streamBuffer)
+		, m_pStream(&stream)
+		, m_style(style)
+	{
+		// Allocated once up front, then reused for every flush
+		m_streamBuffer.reserve(StreamBufferSize + 256);
+	}
+
+	// ***********************************************************************
+
+	JsonWriter::~JsonWriter()
+	{
+		Flush();
+	}
+
+	// ***********************************************************************
+
+	void JsonWriter::Write(const JsonValue& value)
+	{
+		WriteValue(value, 0, m_style == Style::Compact);
+	}
+
+	// ***********************************************************************
+
+	void JsonWriter::Flush()
+	{
+		if (m_pStream == nullptr || m_streamBuffer.empty())
+			return;
+
+		m_pStream->Write(m_streamBuffer.data(), m_streamBuffer.size());
+		m_streamBuffer.clear();
+	}
+
+	// ***********************************************************************
+
+	void JsonWriter::WriteValue(const JsonValue& value, int depth, bool singleLine)
+	{
+		bool pretty = m_style == Style::Pretty;
+		switch (value.m_type)
+		{
+		case JsonValue::Array:
+		case JsonValue::Object:
+		{
+			bool isArray = value.m_type == JsonValue::Array;
+			size_t count = isArray ? value.m_internalData.m_pArray->size() : value.m_internalData.m_pObject->size();
+
+			// Decide whether the container goes on one line before writing any of it
+			if (!singleLine && count > 0)
+				singleLine = SingleLineLength(value, CollapseLength) < CollapseLength;
+			bool newLines = !singleLine && count > 0;
+
+			Append(isArray ? "[" : "{", 1);
+			if (newLines)
+				Append("\n", 1);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				if (newLines)
+					WriteIndent(depth + 1);
+
+				if (isArray)
+				{
+					WriteValue((*value.m_internalData.m_pArray)[i], depth + 1, singleLine);
+				}
+				else
+				{
+					const JsonObject::value_type& member = value.m_internalData.m_pObject->m_members[i];
+					WriteKey(member.first);
+					WriteValue(member.second, depth + 1, singleLine);
+				}
+
+				// Pretty output always has trailing commas, compact output never does
+				if (pretty)
+					Append(newLines ? ", \n" : ", ", newLines ? 3 : 2);
+				else if (i + 1 < count)
+					Append(",", 1);
+			}
+
+			if (newLines)
+				WriteIndent(depth);
+			Append(isArray ? "]" : "}", 1);
+			break;
+		}
+		case JsonValue::Floating:
+		case JsonValue::Integer:
+		{
+			char buffer[MaxNumberLength + 1];
+			Append(buffer, FormatNumber(value, buffer));
+			break;
+		}
+		case JsonValue::Boolean:
+			if (value.m_internalData.m_boolean)
+				Append("true", 4);
+			else
+				Append("false", 5);
+			break;
+		case JsonValue::String:
+			WriteString(value.ToString());
+			break;
+		case JsonValue::Null:
+			Append("null", 4);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// ***********************************************************************
+
+	void JsonWriter::WriteKey(eastl::string_view key)
+	{
+		if (m_style == Style::Pretty && IsIdentifier(key))
+		{
+			Append(key.data(), key.size());
+			Append(": ", 2);
+		}
+		else
+		{
+			WriteString(key);
+			if (m_style == Style::Pretty)
+				Append(": ", 2);
+			else
+				Append(":", 1);
+		}
+	}
+
+	// ***********************************************************************
+
+	void JsonWriter::WriteString(eastl::string_view string)
+	{
+		Append("\"", 1);
+
+		// Copy runs of characters that don't need escaping in one go
+		const char* runStart = string.data();
+		const char* end = string.data() + string.size();
+		for (const char* cursor = runStart; cursor < end; cursor++)
+		{
+			char escape = EscapeFor(*cursor);
+			if (escape == 0)
+				continue;
+
+			Append(runStart, cursor - runStart);
+			if (escape == 'u')
+			{
+				static const char hexDigits[] = "0123456789abcdef";
+				char sequence[6] = { '\\', 'u', '0', '0', hexDigits[(unsigned char)*cursor >> 4], hexDigits[*cursor & 0xf] };
+				Append(sequence, 6);
+			}
+			else
+			{
+				char sequence[2] = { '\\', escape };
+				Append(sequence, 2);
+			}
+			runStart = cursor + 1;
+		}
+		Append(runStart, end - runStart);
+
+		Append("\"", 1);
+	}
+
+	// ***********************************************************************
+
+	void JsonWriter::WriteIndent(int depth)
+	{
+		static const char spaces[] = "                                                                ";
+		size_t remaining = depth * 4;
+		while (remaining > 0)
+		{
+			size_t count = eastl::min(remaining, sizeof(spaces) - 1);
+			Append(spaces, count);
+			remaining -= count;
+		}
+	}
+
+	// ***********************************************************************
+
+	size_t JsonWriter::SingleLineLength(const JsonValue& value, size_t limit)
+	{
+		// Stops as soon as the limit is reached, and children are only given what's left of it, so no call looks at more
+		// than about limit characters however big or deeply nested the container is
+		switch (value.m_type)
+		{
+		case JsonValue::Array:
+		{
+			size_t length = 2;
+			for (const JsonValue& element : *value.m_internalData.m_pArray)
+			{
+				if (length >= limit)
+					return length;
+				length += SingleLineLength(element, limit - length) + 2;
+			}
+			return length;
+		}
+		case JsonValue::Object:
+		{
+			size_t length = 2;
+			for (const JsonObject::value_type& member : *value.m_internalData.m_pObject)
+			{
+				if (length >= limit)
+					return length;
+				length += (IsIdentifier(member.first) ? member.first.size() : EscapedLength(member.first) + 2) + 2;
+				if (length >= limit)
+					return length;
+				length += SingleLineLength(member.second, limit - length) + 2;
+			}
+			return length;
+		}
+		case JsonValue::Floating:
+		case JsonValue::Integer:
+		{
+			char buffer[MaxNumberLength + 1];
+			return FormatNumber(value, buffer);
+		}
+		case JsonValue::Boolean:
+			return value.m_internalData.m_boolean ? 4 : 5;
+		case JsonValue::String:
+			return EscapedLength(value.ToString()) + 2;
+		default:
+			return 4;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <EASTL/string.h>
+#include <EASTL/string_view.h>
+
+namespace An
+{
+    struct JsonValue;
+    class FileStream;
+
+    // Writes JsonValues as text in a single pass, appending to a string or streaming to a file through one reused buffer.
+    struct JsonWriter
+    {
+        enum class Style
+        {
+            // Human readable json5, one member per line with unquoted keys and trailing commas.
+            // Containers that fit on a line are collapsed onto one.
+            Pretty,
+
+            // Strict json with no whitespace
+            Compact
+        };
+
+        JsonWriter(eastl::string& output, Style style = Style::Pretty);
+        JsonWriter(FileStream& stream, Style style = Style::Pretty);
+        ~JsonWriter();
+
+        JsonWriter(const JsonWriter& copy) = delete;
+        JsonWriter& operator=(const JsonWriter& copy) = delete;
+
+        void Write(const JsonValue& value);
+
+        // Sends anything buffered to the file stream, if there is one
+        void Flush();
+
+        // Pretty printed containers shorter than this go on a single line
+        static constexpr size_t CollapseLength = 100;
+
+    private:
+        void WriteValue(const JsonValue& value, int depth, bool singleLine);
+        void WriteKey(eastl::string_view key);
+        void WriteString(eastl::string_view string);
+        void WriteIndent(int depth);
+        size_t SingleLineLength(const JsonValue& value, size_t limit);
+
+        void Append(const char* text, size_t length)
+        {
+            m_pOutput->append(text, text + length);
+            if (m_pStream && m_pOutput->size() >= StreamBufferSize)
+                Flush();
+        }
+
+        static constexpr size_t StreamBufferSize = 64 * 1024;
+
+        eastl::string m_streamBuffer;
+        eastl::string* m_pOutput{ nullptr };
+        FileStream* m_pStream{ nullptr };
+        Style m_style;
+    };
+}
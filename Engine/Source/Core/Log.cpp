@@ -2,13 +2,19 @@
 
 #include "Log.h"
 
+#include <mutex>
+#include <stdio.h>
+
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 
 namespace 
 {
 	FILE* pFile{ nullptr };
 	An::Log::StringHistoryBuffer logHistory(100, eastl::allocator("Log History"));
 	An::Log::LogLevel globalLevel{ An::Log::EDebug };
+	std::mutex logMutex; // Assets are loaded on worker threads, which can log
 } 
 
 namespace An
@@ -22,13 +28,17 @@ namespace An
 			if (level > globalLevel)
 				return;
 
+			std::lock_guard<std::mutex> lock(logMutex);
+
 			// TODO: Use SDL File IO here
 			if (pFile == nullptr)
-				fopen_s(&pFile, "engine.log", "w");
+				pFile = fopen("engine.log", "w");
 			fprintf(pFile, message.c_str());
 			fflush(pFile);
 
+#if defined(_WIN32)
 			OutputDebugStringA(message.c_str());
+#endif
 
 			if (!logHistory.validate())
 				return;
@@ -0,0 +1,43 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include "Path.h"
+
+namespace An
+{
+    // Read only view of a whole file, mapped into memory rather than read. Pages are loaded by the OS as they're touched,
+    // so only the parts of the file that are actually used cost anything, and nothing is copied onto the heap.
+    class MappedFile
+    {
+    public:
+        MappedFile();
+
+        MappedFile(const Path& path);
+
+        MappedFile(MappedFile&& mappedFile);
+
+        MappedFile(const MappedFile& mappedFile) = delete;
+
+        MappedFile& operator=(const MappedFile& mappedFile) = delete;
+
+        ~MappedFile();
+
+        bool Open(const Path& path);
+
+        void Close();
+
+        const char* Data() const { return m_pData; }
+
+        size_t Size() const { return m_size; }
+
+        bool IsValid() const { return m_pData != nullptr || m_isEmpty; }
+
+    private:
+        const char* m_pData{ nullptr };
+        size_t m_size{ 0 };
+        bool m_isEmpty{ false }; // Empty files can't be mapped, but are still valid
+        void* m_fileHandle{ nullptr }; // Windows has to keep the file and mapping open for as long as the view is
+        void* m_mappingHandle{ nullptr };
+    };
+}
@@ -0,0 +1,107 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "MappedFile.h"
+
+#if !defined(_WIN32)
+
+#include "Log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace An
+{
+    // ***********************************************************************
+
+    MappedFile::MappedFile()
+    {
+
+    }
+
+    // ***********************************************************************
+
+    MappedFile::MappedFile(const Path& path)
+    {
+        Open(path);
+    }
+
+    // ***********************************************************************
+
+    MappedFile::MappedFile(MappedFile&& mappedFile)
+    {
+        m_pData = mappedFile.m_pData;
+        m_size = mappedFile.m_size;
+        m_isEmpty = mappedFile.m_isEmpty;
+
+        mappedFile.m_pData = nullptr;
+        mappedFile.m_size = 0;
+        mappedFile.m_isEmpty = false;
+    }
+
+    // ***********************************************************************
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    // ***********************************************************************
+
+    bool MappedFile::Open(const Path& path)
+    {
+        Close();
+
+        int file = open(path.AsRawString(), O_RDONLY);
+        if (file < 0)
+        {
+            Log::Crit("Opening file %s for mapping failed with error: %s", path.AsRawString(), strerror(errno));
+            return false;
+        }
+
+        struct stat fileInfo;
+        if (fstat(file, &fileInfo) != 0)
+        {
+            Log::Crit("Failed to get the size of file %s, error: %s", path.AsRawString(), strerror(errno));
+            close(file);
+            return false;
+        }
+
+        if (fileInfo.st_size == 0)
+        {
+            close(file);
+            m_isEmpty = true;
+            return true;
+        }
+
+        // The mapping stays valid after the file is closed
+        void* pView = mmap(nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (pView == MAP_FAILED)
+        {
+            Log::Crit("Mapping file %s failed with error: %s", path.AsRawString(), strerror(errno));
+            return false;
+        }
+
+        m_pData = (const char*)pView;
+        m_size = (size_t)fileInfo.st_size;
+        return true;
+    }
+
+    // ***********************************************************************
+
+    void MappedFile::Close()
+    {
+        if (m_pData)
+            munmap((void*)m_pData, m_size);
+
+        m_pData = nullptr;
+        m_size = 0;
+        m_isEmpty = false;
+    }
+}
+
+#endif
@@ -0,0 +1,122 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+
+#include "Log.h"
+
+#include <windows.h>
+
+namespace An
+{
+    // ***********************************************************************
+
+    MappedFile::MappedFile()
+    {
+
+    }
+
+    // ***********************************************************************
+
+    MappedFile::MappedFile(const Path& path)
+    {
+        Open(path);
+    }
+
+    // ***********************************************************************
+
+    MappedFile::MappedFile(MappedFile&& mappedFile)
+    {
+        m_pData = mappedFile.m_pData;
+        m_size = mappedFile.m_size;
+        m_isEmpty = mappedFile.m_isEmpty;
+        m_fileHandle = mappedFile.m_fileHandle;
+        m_mappingHandle = mappedFile.m_mappingHandle;
+
+        mappedFile.m_pData = nullptr;
+        mappedFile.m_size = 0;
+        mappedFile.m_isEmpty = false;
+        mappedFile.m_fileHandle = nullptr;
+        mappedFile.m_mappingHandle = nullptr;
+    }
+
+    // ***********************************************************************
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    // ***********************************************************************
+
+    bool MappedFile::Open(const Path& path)
+    {
+        Close();
+
+        HANDLE file = CreateFileA(path.AsRawString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            Log::Crit("Opening file %s for mapping failed with error: %i", path.AsRawString(), (int)GetLastError());
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            Log::Crit("Failed to get the size of file %s, error: %i", path.AsRawString(), (int)GetLastError());
+            CloseHandle(file);
+            return false;
+        }
+
+        if (fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            m_isEmpty = true;
+            return true;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            Log::Crit("Mapping file %s failed with error: %i", path.AsRawString(), (int)GetLastError());
+            CloseHandle(file);
+            return false;
+        }
+
+        void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (pView == nullptr)
+        {
+            Log::Crit("Mapping a view of file %s failed with error: %i", path.AsRawString(), (int)GetLastError());
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        m_pData = (const char*)pView;
+        m_size = (size_t)fileSize.QuadPart;
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+        return true;
+    }
+
+    // ***********************************************************************
+
+    void MappedFile::Close()
+    {
+        if (m_pData)
+            UnmapViewOfFile(m_pData);
+        if (m_mappingHandle)
+            CloseHandle((HANDLE)m_mappingHandle);
+        if (m_fileHandle)
+            CloseHandle((HANDLE)m_fileHandle);
+
+        m_pData = nullptr;
+        m_size = 0;
+        m_isEmpty = false;
+        m_fileHandle = nullptr;
+        m_mappingHandle = nullptr;
+    }
+}
+
+#endif
@@ -0,0 +1,387 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "NumberFormatting.h"
+
+#include <string.h>
+
+namespace An
+{
+	namespace
+	{
+		// A float as significand * 2^exponent with a full 64 bit significand, "do it yourself floating point"
+		struct DiyFp
+		{
+			uint64_t m_significand;
+			int m_exponent;
+		};
+
+		constexpr uint64_t HiddenBit = 0x0010000000000000ull;
+		constexpr uint64_t SignificandMask = 0x000fffffffffffffull;
+		constexpr int ExponentBias = 0x3ff + 52;
+
+		// Normalized 64 bit approximations of 10^k for k = -348, -340, ..., 340, rounded to nearest.
+		// Eight decimal powers apart is close enough that one always brings a product into the range Grisu needs.
+		const DiyFp cachedPowers[] = {
+			{ 0xfa8fd5a0081c0288ull, -1220 }, { 0xbaaee17fa23ebf76ull, -1193 }, { 0x8b16fb203055ac76ull, -1166 },
+			{ 0xcf42894a5dce35eaull, -1140 }, { 0x9a6bb0aa55653b2dull, -1113 }, { 0xe61acf033d1a45dfull, -1087 },
+			{ 0xab70fe17c79ac6caull, -1060 }, { 0xff77b1fcbebcdc4full, -1034 }, { 0xbe5691ef416bd60cull, -1007 },
+			{ 0x8dd01fad907ffc3cull, -980 }, { 0xd3515c2831559a83ull, -954 }, { 0x9d71ac8fada6c9b5ull, -927 },
+			{ 0xea9c227723ee8bcbull, -901 }, { 0xaecc49914078536dull, -874 }, { 0x823c12795db6ce57ull, -847 },
+			{ 0xc21094364dfb5637ull, -821 }, { 0x9096ea6f3848984full, -794 }, { 0xd77485cb25823ac7ull, -768 },
+			{ 0xa086cfcd97bf97f4ull, -741 }, { 0xef340a98172aace5ull, -715 }, { 0xb23867fb2a35b28eull, -688 },
+			{ 0x84c8d4dfd2c63f3bull, -661 }, { 0xc5dd44271ad3cdbaull, -635 }, { 0x936b9fcebb25c996ull, -608 },
+			{ 0xdbac6c247d62a584ull, -582 }, { 0xa3ab66580d5fdaf6ull, -555 }, { 0xf3e2f893dec3f126ull, -529 },
+			{ 0xb5b5ada8aaff80b8ull, -502 }, { 0x87625f056c7c4a8bull, -475 }, { 0xc9bcff6034c13053ull, -449 },
+			{ 0x964e858c91ba2655ull, -422 }, { 0xdff9772470297ebdull, -396 }, { 0xa6dfbd9fb8e5b88full, -369 },
+			{ 0xf8a95fcf88747d94ull, -343 }, { 0xb94470938fa89bcfull, -316 }, { 0x8a08f0f8bf0f156bull, -289 },
+			{ 0xcdb02555653131b6ull, -263 }, { 0x993fe2c6d07b7facull, -236 }, { 0xe45c10c42a2b3b06ull, -210 },
+			{ 0xaa242499697392d3ull, -183 }, { 0xfd87b5f28300ca0eull, -157 }, { 0xbce5086492111aebull, -130 },
+			{ 0x8cbccc096f5088ccull, -103 }, { 0xd1b71758e219652cull, -77 }, { 0x9c40000000000000ull, -50 },
+			{ 0xe8d4a51000000000ull, -24 }, { 0xad78ebc5ac620000ull, 3 }, { 0x813f3978f8940984ull, 30 },
+			{ 0xc097ce7bc90715b3ull, 56 }, { 0x8f7e32ce7bea5c70ull, 83 }, { 0xd5d238a4abe98068ull, 109 },
+			{ 0x9f4f2726179a2245ull, 136 }, { 0xed63a231d4c4fb27ull, 162 }, { 0xb0de65388cc8ada8ull, 189 },
+			{ 0x83c7088e1aab65dbull, 216 }, { 0xc45d1df942711d9aull, 242 }, { 0x924d692ca61be758ull, 269 },
+			{ 0xda01ee641a708deaull, 295 }, { 0xa26da3999aef774aull, 322 }, { 0xf209787bb47d6b85ull, 348 },
+			{ 0xb454e4a179dd1877ull, 375 }, { 0x865b86925b9bc5c2ull, 402 }, { 0xc83553c5c8965d3dull, 428 },
+			{ 0x952ab45cfa97a0b3ull, 455 }, { 0xde469fbd99a05fe3ull, 481 }, { 0xa59bc234db398c25ull, 508 },
+			{ 0xf6c69a72a3989f5cull, 534 }, { 0xb7dcbf5354e9beceull, 561 }, { 0x88fcf317f22241e2ull, 588 },
+			{ 0xcc20ce9bd35c78a5ull, 614 }, { 0x98165af37b2153dfull, 641 }, { 0xe2a0b5dc971f303aull, 667 },
+			{ 0xa8d9d1535ce3b396ull, 694 }, { 0xfb9b7cd9a4a7443cull, 720 }, { 0xbb764c4ca7a44410ull, 747 },
+			{ 0x8bab8eefb6409c1aull, 774 }, { 0xd01fef10a657842cull, 800 }, { 0x9b10a4e5e9913129ull, 827 },
+			{ 0xe7109bfba19c0c9dull, 853 }, { 0xac2820d9623bf429ull, 880 }, { 0x80444b5e7aa7cf85ull, 907 },
+			{ 0xbf21e44003acdd2dull, 933 }, { 0x8e679c2f5e44ff8full, 960 }, { 0xd433179d9c8cb841ull, 986 },
+			{ 0x9e19db92b4e31ba9ull, 1013 }, { 0xeb96bf6ebadf77d9ull, 1039 }, { 0xaf87023b9bf0ee6bull, 1066 },
+		};
+
+		const uint64_t powersOfTen[] = {
+			1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+			10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+			1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+			10000000000000000000ull
+		};
+
+		const char digitPairs[] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+
+		// ***********************************************************************
+
+		// The top 64 bits of the 128 bit product, rounded
+		DiyFp Multiply(DiyFp a, DiyFp b)
+		{
+			const uint64_t mask = 0xffffffffull;
+			uint64_t aHigh = a.m_significand >> 32;
+			uint64_t aLow = a.m_significand & mask;
+			uint64_t bHigh = b.m_significand >> 32;
+			uint64_t bLow = b.m_significand & mask;
+
+			uint64_t highHigh = aHigh * bHigh;
+			uint64_t lowHigh = aLow * bHigh;
+			uint64_t highLow = aHigh * bLow;
+			uint64_t lowLow = aLow * bLow;
+
+			uint64_t middle = (lowLow >> 32) + (highLow & mask) + (lowHigh & mask) + (1ull << 31);
+			return { highHigh + (highLow >> 32) + (lowHigh >> 32) + (middle >> 32), a.m_exponent + b.m_exponent + 64 };
+		}
+
+		// ***********************************************************************
+
+		DiyFp Normalize(DiyFp value)
+		{
+			while ((value.m_significand & (1ull << 63)) == 0)
+			{
+				value.m_significand <<= 1;
+				value.m_exponent--;
+			}
+			return value;
+		}
+
+		// ***********************************************************************
+
+		// Any number between the two boundaries, which are halfway to the neighbouring doubles, parses back to value
+		void Boundaries(DiyFp value, DiyFp& outMinus, DiyFp& outPlus)
+		{
+			outPlus = Normalize({ (value.m_significand << 1) + 1, value.m_exponent - 1 });
+
+			// At a power of two the double below is half as far away as the one above
+			if (value.m_significand == HiddenBit)
+				outMinus = { (value.m_significand << 2) - 1, value.m_exponent - 2 };
+			else
+				outMinus = { (value.m_significand << 1) - 1, value.m_exponent - 1 };
+			outMinus.m_significand <<= outMinus.m_exponent - outPlus.m_exponent;
+			outMinus.m_exponent = outPlus.m_exponent;
+		}
+
+		// ***********************************************************************
+
+		// Finds a cached 10^-k that scales a number with binary exponent exponent into [2^-60, 2^-32) or so
+		DiyFp CachedPower(int exponent, int& outK)
+		{
+			double k = (-61 - exponent) * 0.30102999566398114 + 347; // log10(2)
+			int roundedK = (int)k;
+			if (k - roundedK > 0.0)
+				roundedK++;
+			int index = (roundedK >> 3) + 1;
+			outK = -(-348 + index * 8);
+			return cachedPowers[index];
+		}
+
+		// ***********************************************************************
+
+		// Nudges the last digit down while that brings the number closer to the real value and stays within range
+		void Round(char* digits, int length, uint64_t range, uint64_t rest, uint64_t tenKappa, uint64_t distance)
+		{
+			while (rest < distance && range - rest >= tenKappa && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance))
+			{
+				digits[length - 1]--;
+				rest += tenKappa;
+			}
+		}
+
+		// ***********************************************************************
+
+		// Generates as few digits of upper as are needed to land within range of it, which are all inside the boundaries
+		void GenerateDigits(DiyFp value, DiyFp upper, uint64_t range, char* digits, int& outLength, int& inOutK)
+		{
+			const DiyFp one = { 1ull << -upper.m_exponent, upper.m_exponent };
+			const uint64_t distance = upper.m_significand - value.m_significand;
+
+			uint32_t integral = (uint32_t)(upper.m_significand >> -one.m_exponent);
+			uint64_t fraction = upper.m_significand & (one.m_significand - 1);
+
+			int kappa = 1;
+			while (kappa < 10 && integral >= powersOfTen[kappa])
+				kappa++;
+
+			outLength = 0;
+			while (kappa > 0)
+			{
+				uint32_t power = (uint32_t)powersOfTen[kappa - 1];
+				uint32_t digit = integral / power;
+				integral %= power;
+				if (digit != 0 || outLength != 0)
+					digits[outLength++] = char('0' + digit);
+				kappa--;
+
+				uint64_t rest = ((uint64_t)integral << -one.m_exponent) + fraction;
+				if (rest <= range)
+				{
+					inOutK += kappa;
+					Round(digits, outLength, range, rest, powersOfTen[kappa] << -one.m_exponent, distance);
+					return;
+				}
+			}
+
+			for (;;)
+			{
+				fraction *= 10;
+				range *= 10;
+				char digit = char(fraction >> -one.m_exponent);
+				if (digit != 0 || outLength != 0)
+					digits[outLength++] = char('0' + digit);
+				fraction &= one.m_significand - 1;
+				kappa--;
+				if (fraction < range)
+				{
+					inOutK += kappa;
+					int index = -kappa;
+					Round(digits, outLength, range, fraction, one.m_significand, distance * (index < 20 ? powersOfTen[index] : 0));
+					return;
+				}
+			}
+		}
+
+		// ***********************************************************************
+
+		// Writes the digits of a positive, finite, non zero value such that value = digits * 10^outK
+		void Grisu2(uint64_t bits, char* digits, int& outLength, int& outK)
+		{
+			int biasedExponent = int((bits >> 52) & 0x7ff);
+			DiyFp value;
+			if (biasedExponent != 0)
+				value = { (bits & SignificandMask) + HiddenBit, biasedExponent - ExponentBias };
+			else
+				value = { bits & SignificandMask, 1 - ExponentBias };
+
+			DiyFp minus, plus;
+			Boundaries(value, minus, plus);
+
+			DiyFp power = CachedPower(plus.m_exponent, outK);
+			DiyFp scaled = Multiply(Normalize(value), power);
+			DiyFp scaledPlus = Multiply(plus, power);
+			DiyFp scaledMinus = Multiply(minus, power);
+
+			// The multiplications are off by up to one unit, so the range is shrunk to be safe
+			scaledMinus.m_significand++;
+			scaledPlus.m_significand--;
+			GenerateDigits(scaled, scaledPlus, scaledPlus.m_significand - scaledMinus.m_significand, digits, outLength, outK);
+		}
+
+		// ***********************************************************************
+
+		// Writes value's digits backwards, ending just before end, returning where they start
+		char* WriteDigitsBackwards(uint64_t value, char* end)
+		{
+			while (value >= 100)
+			{
+				const char* pair = digitPairs + (value % 100) * 2;
+				value /= 100;
+				*--end = pair[1];
+				*--end = pair[0];
+			}
+			if (value >= 10)
+			{
+				const char* pair = digitPairs + value * 2;
+				*--end = pair[1];
+				*--end = pair[0];
+			}
+			else
+			{
+				*--end = char('0' + value);
+			}
+			return end;
+		}
+
+		// ***********************************************************************
+
+		// Lays out digits * 10^k plainly if that's short, otherwise in exponent form
+		char* WriteDecimal(const char* digits, int length, int k, char* output)
+		{
+			int point = length + k; // Where the decimal point goes, relative to the first digit
+
+			if (k >= 0 && point <= 16)
+			{
+				// Whole numbers, 1.0 to 1000000000000000.0
+				memcpy(output, digits, length);
+				output += length;
+				memset(output, '0', k);
+				output += k;
+				*output++ = '.';
+				*output++ = '0';
+			}
+			else if (point > 0 && point <= 16)
+			{
+				// 1.5, 1234.5678
+				memcpy(output, digits, point);
+				output += point;
+				*output++ = '.';
+				memcpy(output, digits + point, length - point);
+				output += length - point;
+			}
+			else if (point > -4 && point <= 0)
+			{
+				// 0.5, 0.000123
+				*output++ = '0';
+				*output++ = '.';
+				memset(output, '0', -point);
+				output += -point;
+				memcpy(output, digits, length);
+				output += length;
+			}
+			else
+			{
+				// 1e30, 1.2345e-7
+				*output++ = digits[0];
+				if (length > 1)
+				{
+					*output++ = '.';
+					memcpy(output, digits + 1, length - 1);
+					output += length - 1;
+				}
+				*output++ = 'e';
+				int exponent = point - 1;
+				if (exponent < 0)
+				{
+					*output++ = '-';
+					exponent = -exponent;
+				}
+				char buffer[4];
+				char* start = WriteDigitsBackwards((uint64_t)exponent, buffer + sizeof(buffer));
+				memcpy(output, start, buffer + sizeof(buffer) - start);
+				output += buffer + sizeof(buffer) - start;
+			}
+			return output;
+		}
+	}
+
+	// ***********************************************************************
+
+	size_t FormatFloat(double value, char* output)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		bool negative = (bits >> 63) != 0;
+		bits &= ~(1ull << 63);
+
+		char* cursor = output;
+		if (bits >= 0x7ff0000000000000ull)
+		{
+			const char* text = bits > 0x7ff0000000000000ull ? "NaN" : negative ? "-Infinity" : "Infinity";
+			size_t length = strlen(text);
+			memcpy(output, text, length + 1);
+			return length;
+		}
+
+		if (negative)
+			*cursor++ = '-';
+
+		if (bits == 0)
+		{
+			memcpy(cursor, "0.0", 3);
+			cursor += 3;
+		}
+		else
+		{
+			char digits[20];
+			int length, k;
+			Grisu2(bits, digits, length, k);
+			cursor = WriteDecimal(digits, length, k, cursor);
+		}
+		*cursor = '\0';
+		return size_t(cursor - output);
+	}
+
+	// ***********************************************************************
+
+	size_t FormatInt(int64_t value, char* output)
+	{
+		char buffer[20];
+		uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+		char* start = WriteDigitsBackwards(magnitude, buffer + sizeof(buffer));
+
+		char* cursor = output;
+		if (value < 0)
+			*cursor++ = '-';
+		size_t length = buffer + sizeof(buffer) - start;
+		memcpy(cursor, start, length);
+		cursor += length;
+		*cursor = '\0';
+		return size_t(cursor - output);
+	}
+
+	// ***********************************************************************
+
+	NumberString FloatToString(double value)
+	{
+		NumberString string;
+		string.m_length = FormatFloat(value, string.m_text);
+		return string;
+	}
+
+	// ***********************************************************************
+
+	NumberString IntToString(int64_t value)
+	{
+		NumberString string;
+		string.m_length = FormatInt(value, string.m_text);
+		return string;
+	}
+}
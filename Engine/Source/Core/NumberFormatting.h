@@ -0,0 +1,36 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace An
+{
+    // The most characters FormatFloat or FormatInt will write, not counting the null terminator
+    constexpr size_t MaxNumberLength = 26;
+
+    // Writes a short decimal that parses back to exactly value, e.g. 0.1 rather than 0.10000000000000001, using Grisu2
+    // (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010). Grisu2 always round trips
+    // and is usually the shortest, but for a small fraction of values it's a digit longer than it needs to be.
+    // Always has a '.' or exponent so it reads back as a float, like 1.0 or 1e30, and NaN and infinities are written
+    // as json5's NaN, Infinity and -Infinity. Ignores the locale. Returns the length, output must have room for
+    // MaxNumberLength + 1 characters as it's null terminated.
+    size_t FormatFloat(double value, char* output);
+
+    // Writes value in decimal, returning the length. Output must have room for MaxNumberLength + 1 characters.
+    size_t FormatInt(int64_t value, char* output);
+
+    // A formatted number for passing to printf style functions, e.g. Log::Info("Scale %s", FloatToString(scale).c_str())
+    struct NumberString
+    {
+        const char* c_str() const { return m_text; }
+        size_t size() const { return m_length; }
+
+        char m_text[MaxNumberLength + 1];
+        size_t m_length;
+    };
+
+    NumberString FloatToString(double value);
+    NumberString IntToString(int64_t value);
+}
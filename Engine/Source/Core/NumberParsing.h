@@ -0,0 +1,22 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace An
+{
+    // A number read from text. Integers written without a fraction or exponent are kept exact,
+    // everything else is converted to the nearest double.
+    struct ParsedNumber
+    {
+        bool m_isInteger{ false };
+        int64_t m_integer{ 0 };
+        double m_floating{ 0.0 };
+    };
+
+    // Parses the number starting at cursor, returning a pointer to the first character after it, or nullptr if there
+    // is no valid number there. Accepts json numbers, plus json5's leading '+', leading or trailing '.' and hex integers.
+    // Doubles are correctly rounded, and unlike strtod this doesn't need a null terminator and ignores the locale.
+    const char* ParseNumber(const char* cursor, const char* end, ParsedNumber& outNumber);
+}
@@ -0,0 +1,161 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#include "Parallel.h"
+
+#include <EASTL/algorithm.h>
+#include <EASTL/vector.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace An
+{
+	namespace
+	{
+		// One ParallelFor call, which lives on the calling thread's stack until all of its indices have run
+		struct Batch
+		{
+			const eastl::function<void(uint32_t)>* m_pFunc;
+			uint32_t m_count;
+			uint32_t m_maxHelpers; // Threads other than the caller that may work on it at once
+			uint32_t m_helpers{ 0 }; // Guarded by the pool's mutex
+			std::atomic<uint32_t> m_nextIndex{ 0 };
+		};
+
+		// Workers are started once and shared by every ParallelFor, including ones called from inside a job, so nested
+		// calls never start more threads than there are cores. All the calls in progress are in one queue, and any
+		// thread that's free, workers and callers waiting on their own batch alike, takes indices from the newest
+		// batch that has some left, as that's most likely to be one that another thread is waiting on.
+		class ThreadPool
+		{
+		public:
+			ThreadPool(uint32_t workerCount)
+			{
+				m_workers.reserve(workerCount);
+				for (uint32_t i = 0; i < workerCount; i++)
+					m_workers.emplace_back([this]() { WorkerLoop(); });
+			}
+
+			~ThreadPool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stopping = true;
+				}
+				m_changed.notify_all();
+				for (std::thread& worker : m_workers)
+					worker.join();
+			}
+
+			uint32_t WorkerCount() const
+			{
+				return (uint32_t)m_workers.size();
+			}
+
+			void Run(Batch& batch)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_batches.push_back(&batch);
+				}
+				m_changed.notify_all();
+
+				Work(batch);
+
+				// Every index has been handed out now, so no more helpers can join. While the ones still going finish
+				// this thread helps with other batches rather than sitting idle.
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_batches.erase(eastl::find(m_batches.begin(), m_batches.end(), &batch));
+				while (batch.m_helpers > 0)
+				{
+					if (!HelpWithBatch(lock))
+						m_changed.wait(lock);
+				}
+			}
+
+		private:
+			static void Work(Batch& batch)
+			{
+				for (uint32_t index = batch.m_nextIndex++; index < batch.m_count; index = batch.m_nextIndex++)
+					(*batch.m_pFunc)(index);
+			}
+
+			// Runs indices from a batch that has some left and room for another thread, if there is one. The lock is held
+			// when this is called and when it returns, but not while the indices run.
+			bool HelpWithBatch(std::unique_lock<std::mutex>& lock)
+			{
+				Batch* pBatch = nullptr;
+				for (size_t i = m_batches.size(); i > 0 && pBatch == nullptr; i--)
+				{
+					Batch* pCandidate = m_batches[i - 1];
+					if (pCandidate->m_nextIndex.load() < pCandidate->m_count && pCandidate->m_helpers < pCandidate->m_maxHelpers)
+						pBatch = pCandidate;
+				}
+				if (pBatch == nullptr)
+					return false;
+
+				pBatch->m_helpers++;
+				lock.unlock();
+				Work(*pBatch);
+				lock.lock();
+
+				// The batch's caller may be waiting for its last helper to finish
+				if (--pBatch->m_helpers == 0)
+					m_changed.notify_all();
+				return true;
+			}
+
+			void WorkerLoop()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (!m_stopping)
+				{
+					if (!HelpWithBatch(lock))
+						m_changed.wait(lock);
+				}
+			}
+
+			std::mutex m_mutex;
+			std::condition_variable m_changed; // Signalled when a batch is added, or loses its last helper
+			eastl::vector<Batch*> m_batches;
+			eastl::vector<std::thread> m_workers;
+			bool m_stopping{ false };
+		};
+
+		ThreadPool& GetThreadPool()
+		{
+			// The calling thread always works too, so one worker fewer than there are hardware threads keeps them all busy
+			static ThreadPool pool(HardwareThreadCount() - 1);
+			return pool;
+		}
+	}
+
+	// ***********************************************************************
+
+	void ParallelFor(uint32_t count, const eastl::function<void(uint32_t)>& func, uint32_t maxThreads)
+	{
+		Batch batch;
+		batch.m_pFunc = &func;
+		batch.m_count = count;
+
+		ThreadPool& pool = GetThreadPool();
+		uint32_t maxHelpers = maxThreads == 0 ? pool.WorkerCount() : maxThreads - 1;
+		batch.m_maxHelpers = eastl::min(maxHelpers, count > 0 ? count - 1 : 0);
+		if (batch.m_maxHelpers == 0 || pool.WorkerCount() == 0)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				func(i);
+			return;
+		}
+		pool.Run(batch);
+	}
+
+	// ***********************************************************************
+
+	uint32_t HardwareThreadCount()
+	{
+		uint32_t count = std::thread::hardware_concurrency();
+		return count == 0 ? 1 : count;
+	}
+}
@@ -0,0 +1,19 @@
+// Copyright 2020-2021 David Colson. All rights reserved.
+
+#pragma once
+
+#include <EASTL/functional.h>
+#include <stdint.h>
+
+namespace An
+{
+    // Calls func once for each index from 0 to count - 1, spread over worker threads, and returns when they've all finished.
+    // The calling thread does its share of the work. Indices are handed out one at a time as threads become free, so
+    // jobs don't need to take the same time. maxThreads of 0 uses one thread per hardware thread.
+    // Workers are a pool started on first use and shared by every call, and a caller waiting for its last indices helps
+    // with other calls' jobs meanwhile, so ParallelFor can be called from inside a job without oversubscribing the cores.
+    void ParallelFor(uint32_t count, const eastl::function<void(uint32_t)>& func, uint32_t maxThreads = 0);
+
+    // The number of threads ParallelFor uses at most
+    uint32_t HardwareThreadCount();
+}
@@ -34,15 +34,6 @@ namespace An
 
 	// ***********************************************************************
 
-	bool Scan::IsWhitespace(char c)
-	{
-		if(c == ' ' || c == '\r' || c == '\t' || c == '\n')
-			return true;
-		return false;
-	}
-
-	// ***********************************************************************
-
 	void Scan::AdvanceOverWhitespace(ScanningState& scan)
 	{
 		char c = *(scan.current);
@@ -81,29 +72,8 @@ namespace An
 
 	// ***********************************************************************
 
-	bool Scan::IsDigit(char c)
-	{
-		return (c >= '0' && c <= '9');
-	}
-
-	// ***********************************************************************
-
 	bool Scan::IsHexDigit(char c)
 	{
 		return isxdigit(c);
 	}
-
-	// ***********************************************************************
-
-	bool Scan::IsAlpha(char c)
-	{
-		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
-	}
-
-	// ***********************************************************************
-
-	bool Scan::IsAlphaNumeric(char c)
-	{
-		return IsAlpha(c) || IsDigit(c);
-	}
 }
\ No newline at end of file
@@ -38,7 +38,11 @@ namespace An::Scan
 
     char PeekNext(ScanningState& scan);
 
-    bool IsWhitespace(char c);
+    // Character classes are inline as they're called for every character of the text being scanned
+    inline bool IsWhitespace(char c)
+    {
+        return c == ' ' || c == '\r' || c == '\t' || c == '\n';
+    }
 
     void AdvanceOverWhitespace(ScanningState& scan);
 
@@ -46,13 +50,22 @@ namespace An::Scan
 
     bool IsPartOfNumber(char c);
 
-    bool IsDigit(char c);
+    inline bool IsDigit(char c)
+    {
+        return (c >= '0' && c <= '9');
+    }
 
     bool IsHexDigit(char c);
 
-    bool IsAlpha(char c);
+    inline bool IsAlpha(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
     
-    bool IsAlphaNumeric(char c);
+    inline bool IsAlphaNumeric(char c)
+    {
+        return IsAlpha(c) || IsDigit(c);
+    }
 
     eastl::string ParseToString(ScanningState& scan, char bound);
 }
\ No newline at end of file
@@ -11,5 +11,10 @@ int Vsnprintf8(char* p, size_t n, const char* pFormat, va_list arguments)
 
 int Vsnprintf16(char16_t* p, size_t n, const char16_t* pFormat, va_list arguments)
 {
+#if defined(_WIN32)
     return vswprintf_s((wchar_t*)p, n, (wchar_t*)pFormat, arguments);
+#else
+    // wchar_t is 32 bit everywhere else, so there's no standard function for this, and the engine doesn't use 16 bit strings
+    return -1;
+#endif
 }
\ No newline at end of file
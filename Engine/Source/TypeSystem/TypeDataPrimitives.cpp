@@ -30,11 +30,11 @@ namespace An
 
 		eastl::vector<Enumerator>::iterator it = eastl::find_if(categories.begin(), categories.end(), [&val](Enumerator& enumerator) 
 		{
-			return enumerator.m_identifier == val.ToString();
+			return val.ToString() == enumerator.m_identifier.c_str();
 		});
 
 		if (it == categories.end())
-			Log::Crit("Attempting to create an enum from an invalid jsonValue: %s", val.ToString().c_str());
+			Log::Crit("Attempting to create an enum from an invalid jsonValue: %s", val.ToString().data());
 
 		return OwnedTypedPtr::New<int>((int)eastl::distance(categories.begin(), it));
 	}
@@ -56,7 +56,7 @@ namespace An
 
 		virtual JsonValue ToJson(TypedPtr var) override
 		{
-			return JsonValue((long)var.CastRef<int>());
+			return JsonValue((int64_t)var.CastRef<int>());
 		}
 
 		virtual OwnedTypedPtr FromJson(const JsonValue& val) override
@@ -157,7 +157,7 @@ namespace An
 
 		virtual OwnedTypedPtr FromJson(const JsonValue& val) override
 		{
-			return OwnedTypedPtr::New<eastl::string>(val.ToString());
+			return OwnedTypedPtr::New<eastl::string>(eastl::string(val.ToString()));
 		}
 	};
 	template <>
@@ -10,7 +10,7 @@ namespace An
 	{
 		JsonValue result = JsonValue::NewObject();
 
-		// TODO: Order of members is lost using this method. We have our member offsets, see if we can use it somehow
+		// Members are visited in offset order, which json objects preserve, so they serialize in declaration order
 		for (Member& member : value.GetType().AsStruct())
 		{
 			result[member.GetName()] = member.GetType().ToJson(member.Get(value));
@@ -25,11 +25,11 @@ namespace An
 	{
 		OwnedTypedPtr var = New();
 
-		for (const eastl::pair<eastl::string, JsonValue>& val : *json.m_internalData.m_pObject)
+		for (const JsonObject::value_type& val : *json.m_internalData.m_pObject)
 		{
-			if (MemberExists(val.first.c_str()))
+			if (MemberExists(val.first.data()))
 			{
-				Member& mem = GetMember(val.first.c_str());
+				Member& mem = GetMember(val.first.data());
 
 				OwnedTypedPtr parsed = mem.GetType().FromJson(val.second);
 				mem.Set(var.Ref(), parsed.Ref());   
@@ -7,6 +7,7 @@
 #include "AssetDatabase/Image.h"
 #include "Core/Vec3.h"
 #include "Core/Matrix.h"
+#include "Core/Parallel.h"
 #include "Input.h"
 #include "Core/Log.h"
 
@@ -55,8 +56,11 @@ namespace An
 		bgfx::UniformHandle m_baseColorUniform;
 		bgfx::UniformHandle m_baseColorTextureSampler;
 		bgfx::UniformHandle m_lightDirectionUniform;
+		bgfx::UniformHandle m_dequantizeUniform;
 		bgfx::ProgramHandle m_texturedProgram;
 		bgfx::ProgramHandle m_untexturedProgram;
+		bgfx::ProgramHandle m_texturedQuantizedProgram;
+		bgfx::ProgramHandle m_untexturedQuantizedProgram;
 	};
 
 	void RenderScene(Scene& scene, RendererState& renderer)
@@ -69,10 +73,13 @@ namespace An
 				{
 					bgfx::setTransform(&node.m_worldTransform);
 					
-					bgfx::setVertexBuffer(0, prim.m_vertexBuffer);
-					bgfx::setVertexBuffer(1, prim.m_uv0Buffer);
-					bgfx::setVertexBuffer(2, prim.m_normalsBuffer);
-					bgfx::setIndexBuffer(prim.m_indexBuffer);
+					prim.SetBuffers();
+
+					bool quantized = prim.m_vertexFormat == Primitive::VertexFormat::Quantized;
+					if (quantized)
+						bgfx::setUniform(renderer.m_dequantizeUniform, prim.m_dequantize, 3);
+					bgfx::ProgramHandle texturedProgram = quantized ? renderer.m_texturedQuantizedProgram : renderer.m_texturedProgram;
+					bgfx::ProgramHandle untexturedProgram = quantized ? renderer.m_untexturedQuantizedProgram : renderer.m_untexturedProgram;
 
 					if (prim.m_baseColorTexture != UINT32_MAX) // Textured
 					{
@@ -86,7 +93,7 @@ namespace An
 
 						Image& image = scene.m_images[prim.m_baseColorTexture];
 						bgfx::setTexture(0, renderer.m_baseColorTextureSampler,  image.m_gpuHandle);
-						bgfx::submit(0, renderer.m_texturedProgram);
+						bgfx::submit(0, texturedProgram);
 					}
 					else if (prim.m_baseColor.w < 1.0f) // Transparent material
 					{
@@ -99,7 +106,7 @@ namespace An
 						bgfx::setState(state);
 
 						bgfx::setUniform(renderer.m_baseColorUniform, &prim.m_baseColor);
-						bgfx::submit(0, renderer.m_untexturedProgram);
+						bgfx::submit(0, untexturedProgram);
 					}
 					else	// No transparency, no texture
 					{
@@ -111,7 +118,7 @@ namespace An
 						bgfx::setState(state);
 
 						bgfx::setUniform(renderer.m_baseColorUniform, &prim.m_baseColor);
-						bgfx::submit(0, renderer.m_untexturedProgram);
+						bgfx::submit(0, untexturedProgram);
 					}
 				}
 			}
@@ -138,14 +145,44 @@ int main(int argc, char *argv[])
 	RendererState rState;
 
 	Shader basicVertShader = Shader("Engine/Shaders/default.vs");
+	Shader quantizedVertShader = Shader("Engine/Shaders/default.vs", "QUANTIZED_VERTICES=1");
 	Shader texturedLitShader = Shader("Engine/Shaders/texturedLit.fs");
 	Shader untexturedLitShader = Shader("Engine/Shaders/untexturedLit.fs");
 
 	rState.m_texturedProgram = bgfx::createProgram(basicVertShader.m_handle, texturedLitShader.m_handle, false);
 	rState.m_untexturedProgram = bgfx::createProgram(basicVertShader.m_handle, untexturedLitShader.m_handle, false);
+	rState.m_texturedQuantizedProgram = bgfx::createProgram(quantizedVertShader.m_handle, texturedLitShader.m_handle, false);
+	rState.m_untexturedQuantizedProgram = bgfx::createProgram(quantizedVertShader.m_handle, untexturedLitShader.m_handle, false);
+
+	// Both scenes import at once, with their jobs sharing the same worker threads, then their GPU resources are made
+	// here on the render thread
+	Scene plane;
+	Scene terrain;
+	bool imported[2];
+	ParallelFor(2, [&](uint32_t i)
+	{
+		if (i == 0)
+			imported[i] = plane.Import("Game/Assets/Spitfire.gltf");
+		else
+			imported[i] = terrain.Import("Game/Assets/FirstTerrain.gltf");
+	});
+	if (!imported[0] || !imported[1])
+	{
+		CloseWindow();
+		return 1;
+	}
 
-	Scene plane("Game/Assets/Spitfire.gltf");
-	Scene terrain("Game/Assets/FirstTerrain.gltf");
+	// Quantized vertices are around half the size, and the quantized programs unpack them in the vertex shader
+	for (Scene* pScene : { &plane, &terrain })
+	{
+		for (Mesh& mesh : pScene->m_meshes)
+		{
+			for (Primitive& prim : mesh.m_primitives)
+				prim.m_vertexFormat = Primitive::VertexFormat::Quantized;
+		}
+	}
+	plane.CreateGpuResources();
+	terrain.CreateGpuResources();
 
 	TransformNodeHeirarchy(terrain.m_nodes);
 	TransformNodeHeirarchy(plane.m_nodes);
@@ -157,6 +194,7 @@ int main(int argc, char *argv[])
 	rState.m_baseColorTextureSampler = bgfx::createUniform("s_texColor",  bgfx::UniformType::Sampler);
 	rState.m_lightDirectionUniform = bgfx::createUniform("u_lightDir", bgfx::UniformType::Vec4);
 	rState.m_baseColorUniform = bgfx::createUniform("u_baseColor", bgfx::UniformType::Vec4);
+	rState.m_dequantizeUniform = bgfx::createUniform("u_dequantize", bgfx::UniformType::Vec4, 3);
 
 	while (!ShouldWindowClose())
 	{
@@ -50,4 +50,5 @@ solution "Athena"
     dofile("Engine/Source/ThirdParty/EABase.lua")
     dofile("Engine/Source/ThirdParty/EASTL.lua")
     dofile("Engine/Engine.lua")
-    dofile("Game/Game.lua")
\ No newline at end of file
+    dofile("Game/Game.lua")
+    dofile("Benchmarks/Benchmarks.lua")
\ No newline at end of file